@@ -0,0 +1,23 @@
+/* Common definitions for the throughput benchmarks.
+ *
+ * The programs run under the CREATOR kernel reset vector (-k): it calls
+ * main() in user mode and exits through ecall 10 when main returns. The
+ * simulator only needs the tohost symbol, placed by link_RV32.ld and
+ * link_RV64.ld where the reset vector expects it. */
+
+#if __riscv_xlen == 64
+#define LREG ld
+#define SREG sd
+#define REGBYTES 8
+#else
+#define LREG lw
+#define SREG sw
+#define REGBYTES 4
+#endif
+
+#define BENCH_MAIN                        \
+  .section .tohost, "aw", @progbits;      \
+  .align 6; .globl tohost; tohost: .dword 0;     \
+  .align 6; .globl fromhost; fromhost: .dword 0; \
+  .section .text.main, "ax", @progbits;   \
+  .globl main; main:
@@ -0,0 +1,57 @@
+#!/bin/bash
+# Compares the debug (default) and noassert WASM profiles: .wasm size against
+# the shipped binaries/ and speed of the benchmarks under Node.
+#
+#   bench/compare_profiles.sh RV32|RV64 [runs]
+#
+# Needs emcc, node and a RISC-V cross compiler. RV32 uses VECT (0 by
+# default, as binaries/riscv_sim_RV32.wasm; VECT=1 compares with RV32vd).
+# The binaries in binaries/ are rewritten for the IDE and cannot run under
+# Node, so the speed baseline is PROFILE=debug, the profile they are built
+# with.
+
+set -euo pipefail
+
+ARCH=${1:-RV32}
+RUNS=${2:-3}
+VECT=${VECT:-0}
+OUT=bench/build/$ARCH/profiles
+
+case "$ARCH" in
+  RV32) FLAGS="-p -z 4"; SHIPPED=binaries/riscv_sim_RV32.wasm
+        if [ "$VECT" != 0 ]; then SHIPPED=binaries/riscv_sim_RV32vd.wasm; fi ;;
+  RV64) FLAGS="-p"; SHIPPED=binaries/riscv_sim_RV64.wasm ;;
+  *) echo "Invalid architecture: $ARCH (use RV32 or RV64)"; exit 1 ;;
+esac
+
+ELFS=""
+for s in bench/*.S; do
+  ELFS="$ELFS bench/build/$ARCH/$(basename "$s" .S).elf"
+done
+make ARCH=$ARCH $ELFS
+
+mkdir -p $OUT
+for p in debug noassert; do
+  mkdir -p $OUT/$p
+  make LOCAL=0 VECT=$VECT ARCH=$ARCH PROFILE=$p EM_ENV=web c_emulator/riscv_sim_$ARCH
+  mv c_emulator/riscv_sim_$ARCH.wasm $OUT/$p/riscv_sim_${ARCH}_web.wasm
+  rm -f c_emulator/riscv_sim_$ARCH.js
+  make LOCAL=0 VECT=$VECT ARCH=$ARCH PROFILE=$p EM_ENV=node c_emulator/riscv_sim_$ARCH
+  mv c_emulator/riscv_sim_${ARCH}_node.mjs c_emulator/riscv_sim_${ARCH}_node.wasm $OUT/$p/
+done
+
+size_line() {
+  printf "%-44s %10d %10d\n" "$1" "$(stat -c %s "$1")" "$(gzip -9 -c "$1" | wc -c)"
+}
+
+{
+  printf "%-44s %10s %10s\n" "wasm" "bytes" "gzip -9"
+  size_line $SHIPPED
+  size_line $OUT/debug/riscv_sim_${ARCH}_web.wasm
+  size_line $OUT/noassert/riscv_sim_${ARCH}_web.wasm
+} | tee $OUT/sizes.txt
+
+node bench/run_wasm_bench.mjs \
+  --module $OUT/debug/riscv_sim_${ARCH}_node.mjs \
+  --module $OUT/noassert/riscv_sim_${ARCH}_node.mjs \
+  --out $OUT/report.json --runs $RUNS -- $FLAGS -- $ELFS
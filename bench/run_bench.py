@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+# Runs the throughput benchmarks on a local simulator build and writes a JSON
+# report with MIPS, initialization time and peak RSS for each workload.
+#
+#   run_bench.py --sim c_emulator/riscv_sim_RV32 --out report.json \
+#                [--runs N] -- <simulator flags> -- bench1.elf bench2.elf ...
+
+import argparse, json, os, subprocess, sys, tempfile, time
+
+def parse_times(stderr):
+    # Lines printed by finish() in riscv_sim.c when run with -p.
+    res = {}
+    for l in stderr.splitlines():
+        f = l.split()
+        if l.startswith("Initialization:"): res["init_ms"]      = int(f[1])
+        if l.startswith("Execution:"):      res["exec_ms"]      = int(f[1])
+        if l.startswith("Instructions:"):   res["instructions"] = int(f[1])
+    return res
+
+def run_one(sim, flags, elf):
+    with tempfile.TemporaryFile("w+") as out, tempfile.TemporaryFile("w+") as err:
+        start = time.monotonic()
+        p = subprocess.Popen([sim] + flags + [elf], stdout=out, stderr=err)
+        # Reap the child ourselves to get its own ru_maxrss (KB on Linux).
+        _, status, usage = os.wait4(p.pid, 0)
+        wall = time.monotonic() - start
+        p.returncode = os.waitstatus_to_exitcode(status)
+        out.seek(0)
+        err.seek(0)
+        stdout, stderr = out.read(), err.read()
+
+    r = parse_times(stderr)
+    r["wall_ms"] = int(wall * 1000)
+    r["peak_rss_kb"] = usage.ru_maxrss
+    r["status"] = "ok" if p.returncode == 0 and "SUCCESS" in stdout else "fail"
+    if r.get("exec_ms") and r.get("instructions"):
+        r["mips"] = r["instructions"] / (r["exec_ms"] * 1000.0)
+    return r
+
+def main():
+    parser = argparse.ArgumentParser(description="Simulator throughput benchmarks")
+    parser.add_argument("--sim", required=True, help="local simulator binary")
+    parser.add_argument("--out", required=True, help="JSON report file")
+    parser.add_argument("--runs", type=int, default=1, help="runs per workload, best kept")
+    parser.add_argument("rest", nargs=argparse.REMAINDER)
+    args = parser.parse_args()
+
+    rest = args.rest
+    if rest and rest[0] == "--": rest = rest[1:]
+    if "--" not in rest:
+        parser.error("expected: -- <simulator flags> -- <elf files>")
+    sep = rest.index("--")
+    flags, elfs = rest[:sep], rest[sep + 1:]
+
+    report = {"simulator": args.sim, "flags": flags,
+              "date": time.strftime("%Y-%m-%dT%H:%M:%S"), "workloads": []}
+    for elf in elfs:
+        name = os.path.splitext(os.path.basename(elf))[0]
+        best = None
+        for _ in range(args.runs):
+            r = run_one(args.sim, flags, elf)
+            if best is None or r.get("mips", 0) > best.get("mips", 0):
+                best = r
+        best["name"] = name
+        report["workloads"].append(best)
+        print("{0:16} {1:>6} {2:>10} insts {3:>8.3f} MIPS {4:>6} ms init {5:>8} KB".format(
+            name, best["status"], best.get("instructions", 0), best.get("mips", 0.0),
+            best.get("init_ms", 0), best["peak_rss_kb"]))
+
+    with open(args.out, "w") as f:
+        json.dump(report, f, indent=2)
+    print("Report written to " + args.out)
+    return 0 if all(w["status"] == "ok" for w in report["workloads"]) else 1
+
+if __name__ == '__main__':
+    sys.exit(main())
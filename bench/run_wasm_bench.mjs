@@ -0,0 +1,172 @@
+#!/usr/bin/env node
+// Runs the throughput benchmarks on the WASM simulator under Node and writes a
+// JSON report with instantiation time, time to first instruction and MIPS.
+// The modules must be built for node (make ... LOCAL=0 EM_ENV=node), the
+// browser binaries/ are rewritten for the IDE and cannot be loaded here.
+//
+//   node bench/run_wasm_bench.mjs --module c_emulator/riscv_sim_RV32_node.mjs \
+//        [--module other_build.mjs] --out report.json [--runs N] [--warmup N] \
+//        [--data key=value ...] -- <simulator flags> -- bench1.elf bench2.elf ...
+
+import fs from "node:fs";
+import path from "node:path";
+import { performance } from "node:perf_hooks";
+import { pathToFileURL } from "node:url";
+
+// Valores que el IDE deja en document.app.$data y que lee el simulador con
+// emscripten_run_script_int. Ejecucion completa (sin paso a paso ni
+// breakpoints), kernel de CREATOR en modo usuario y cache L1 unificada.
+const defaultData = {
+  c_kernel: 1,
+  c_sudo: 0,
+  entry_elf: 0,
+  execution_mode_run: 0,
+  is_breakpoint: 0,
+  cache_type: 0,
+  isDirect: 0,
+  data_cache_block_size: 32,
+};
+for (const c of ["L1", "L1_I", "L1_D", "L2", "L2_I", "L2_D"]) {
+  defaultData[c + "_size"] = 64;
+  defaultData[c + "_size_block"] = 32;
+  defaultData[c + "_num_lines"] = 4;
+}
+
+function usage(msg) {
+  if (msg) console.error(msg);
+  console.error("usage: run_wasm_bench.mjs --module <sim.mjs> [--module ...] --out <report.json>" +
+                " [--runs N] [--warmup N] [--data key=value ...] -- <simulator flags> -- <elf files>");
+  process.exit(2);
+}
+
+function parseArgs(argv) {
+  const args = { modules: [], out: null, runs: 1, warmup: 1, data: {} };
+  let i = 0;
+  for (; i < argv.length && argv[i] !== "--"; i++) {
+    const a = argv[i], v = argv[i + 1];
+    if (a === "--module") { args.modules.push(v); i++; }
+    else if (a === "--out") { args.out = v; i++; }
+    else if (a === "--runs") { args.runs = parseInt(v, 10); i++; }
+    else if (a === "--warmup") { args.warmup = parseInt(v, 10); i++; }
+    else if (a === "--data") {
+      const eq = v ? v.indexOf("=") : -1;
+      if (eq < 0) usage("--data expects key=value");
+      args.data[v.slice(0, eq)] = Number(v.slice(eq + 1));
+      i++;
+    } else usage("unknown option " + a);
+  }
+  const rest = argv.slice(i + 1);
+  const sep = rest.indexOf("--");
+  if (i >= argv.length || sep < 0) usage("expected: -- <simulator flags> -- <elf files>");
+  args.flags = rest.slice(0, sep);
+  args.elfs = rest.slice(sep + 1);
+  if (!args.modules.length || !args.out || !args.elfs.length) usage();
+  if (!(args.runs >= 1) || !(args.warmup >= 0)) usage("--runs must be >= 1 and --warmup >= 0");
+  return args;
+}
+
+// Direccion de entrada de la cabecera ELF (e_entry), el IDE la pasa en entry_elf
+function elfEntry(bytes) {
+  if (bytes.readUInt32BE(0) !== 0x7f454c46) throw new Error("not an ELF file");
+  return bytes[4] === 2 ? Number(bytes.readBigUInt64LE(24)) : bytes.readUInt32LE(24);
+}
+
+// Lines printed by finish() in riscv_sim.c when run with -p.
+function parseTimes(stderr) {
+  const res = {};
+  for (const l of stderr) {
+    const f = l.trim().split(/\s+/);
+    if (l.startsWith("Initialization:")) res.init_ms = parseInt(f[1], 10);
+    if (l.startsWith("Execution:")) res.exec_ms = parseInt(f[1], 10);
+    if (l.startsWith("Instructions:")) res.instructions = parseInt(f[1], 10);
+  }
+  return res;
+}
+
+// Compiles the .wasm next to the module once, so the per-run instantiation
+// time does not include the compilation.
+async function loadModule(modPath) {
+  const factory = (await import(pathToFileURL(path.resolve(modPath)).href)).default;
+  const wasmPath = modPath.replace(/\.mjs$/, ".wasm");
+  const t0 = performance.now();
+  const compiled = await WebAssembly.compile(fs.readFileSync(wasmPath));
+  return { factory, compiled, compile_ms: performance.now() - t0 };
+}
+
+async function runOne(mod, flags, elf, bytes) {
+  const stdout = [], stderr = [];
+  let exitCode = null;
+
+  const t0 = performance.now();
+  const sim = await mod.factory({
+    noInitialRun: true,
+    print: (l) => stdout.push(l),
+    printErr: (l) => stderr.push(l),
+    // exit() del simulador: se guarda el codigo en vez de terminar node
+    quit: (status, toThrow) => { exitCode = status; throw toThrow; },
+    instantiateWasm: (imports, receiveInstance) => {
+      WebAssembly.instantiate(mod.compiled, imports)
+        .then((instance) => receiveInstance(instance, mod.compiled));
+      return {};
+    },
+  });
+  const t1 = performance.now();
+
+  sim.FS.writeFile("/prog.elf", bytes);
+  const t2 = performance.now();
+  const ret = sim.callMain([...flags, "/prog.elf"]);
+  const t3 = performance.now();
+  if (exitCode === null) exitCode = ret;
+
+  const r = parseTimes(stderr);
+  r.instantiate_ms = t1 - t0;
+  r.wall_ms = t3 - t0;
+  // Hasta que el simulador termina init_sail y ejecuta la primera instruccion
+  if (r.init_ms !== undefined) r.first_insn_ms = (t2 - t0) + r.init_ms;
+  r.status = exitCode === 0 && stdout.includes("SUCCESS") ? "ok" : "fail";
+  if (r.exec_ms && r.instructions) r.mips = r.instructions / (r.exec_ms * 1000.0);
+  return r;
+}
+
+async function main() {
+  const args = parseArgs(process.argv.slice(2));
+  const report = { flags: args.flags, node: process.version,
+                   date: new Date().toISOString(), modules: [] };
+
+  let allOk = true;
+  for (const modPath of args.modules) {
+    const mod = await loadModule(modPath);
+    const entry = { module: modPath, compile_ms: mod.compile_ms, workloads: [] };
+    console.log(`${modPath}: compiled in ${mod.compile_ms.toFixed(1)} ms`);
+
+    for (const elf of args.elfs) {
+      const bytes = fs.readFileSync(elf);
+      globalThis.document = { app: { $data: { ...defaultData, entry_elf: elfEntry(bytes), ...args.data } } };
+      globalThis.resetenvironment = () => {};
+
+      // The first runs warm up the JIT; steady state is the best of the rest.
+      let first = null, best = null;
+      for (let n = 0; n < args.warmup + args.runs; n++) {
+        const r = await runOne(mod, args.flags, elf, bytes);
+        if (first === null) first = r;
+        if (n >= args.warmup && (best === null || (r.mips ?? 0) > (best.mips ?? 0))) best = r;
+      }
+      const w = { name: path.basename(elf, path.extname(elf)), status: best.status,
+                  instructions: best.instructions, init_ms: best.init_ms, exec_ms: best.exec_ms,
+                  cold_instantiate_ms: first.instantiate_ms, cold_first_insn_ms: first.first_insn_ms,
+                  instantiate_ms: best.instantiate_ms, first_insn_ms: best.first_insn_ms,
+                  wall_ms: best.wall_ms, mips: best.mips };
+      entry.workloads.push(w);
+      allOk &&= w.status === "ok";
+      console.log(`  ${w.name.padEnd(16)} ${w.status.padStart(6)} ${String(w.instructions ?? 0).padStart(10)} insts` +
+                  ` ${(w.mips ?? 0).toFixed(3).padStart(8)} MIPS ${(w.first_insn_ms ?? 0).toFixed(1).padStart(8)} ms to first insn`);
+    }
+    report.modules.push(entry);
+  }
+
+  fs.writeFileSync(args.out, JSON.stringify(report, null, 2));
+  console.log("Report written to " + args.out);
+  process.exit(allOk ? 0 : 1);
+}
+
+main().catch((e) => { console.error(e); process.exit(1); });
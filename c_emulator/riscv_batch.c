@@ -0,0 +1,195 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "riscv_batch.h"
+
+/* Batch mode, see riscv_batch.h */
+
+#define BATCH_LINE_MAX 4096
+
+struct batch_reader {
+  FILE *f;
+  const char *name;
+  unsigned line;
+  char buf[BATCH_LINE_MAX];
+};
+
+bool batch_mode = false;
+
+static uint64_t start_ms, deadline_ms;
+static unsigned job_count;
+
+static uint64_t now_ms(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+struct batch_reader *batch_open(const char *manifest)
+{
+  struct batch_reader *b = calloc(1, sizeof(*b));
+  if (b == NULL) {
+    fprintf(stderr, "Cannot allocate batch reader\n");
+    exit(1);
+  }
+  b->f = fopen(manifest, "r");
+  if (b->f == NULL) {
+    fprintf(stderr, "Cannot open batch manifest '%s'\n", manifest);
+    exit(1);
+  }
+  b->name = manifest;
+  job_count = 0;
+  return b;
+}
+
+static uint64_t parse_limit(struct batch_reader *b, const char *value, uint64_t max)
+{
+  char *end;
+  errno = 0;
+  uint64_t v = strtoull(value, &end, 0);
+  if (*value == '\0' || *end != '\0' || errno == ERANGE || v > max) {
+    fprintf(stderr, "%s:%u: invalid limit '%s'\n", b->name, b->line, value);
+    exit(1);
+  }
+  return v;
+}
+
+bool batch_next(struct batch_reader *b, struct batch_job *job)
+{
+  while (fgets(b->buf, sizeof(b->buf), b->f) != NULL) {
+    b->line++;
+    char *comment = strchr(b->buf, '#');
+    if (comment)
+      *comment = '\0';
+
+    memset(job, 0, sizeof(*job));
+    job->line = b->line;
+    for (char *tok = strtok(b->buf, " \t\r\n"); tok; tok = strtok(NULL, " \t\r\n")) {
+      if (strncmp(tok, "input=", 6) == 0)
+        job->input = tok + 6;
+      else if (strncmp(tok, "expected=", 9) == 0)
+        job->expected = tok + 9;
+      else if (strncmp(tok, "insns=", 6) == 0)
+        job->insns = parse_limit(b, tok + 6, INT_MAX); /* como --inst-limit */
+      else if (strncmp(tok, "ms=", 3) == 0)
+        job->ms = parse_limit(b, tok + 3, UINT64_MAX);
+      else if (job->elf == NULL)
+        job->elf = tok;
+      else {
+        fprintf(stderr, "%s:%u: unknown field '%s'\n", b->name, b->line, tok);
+        exit(1);
+      }
+    }
+    if (job->elf != NULL)
+      return true;
+    if (job->input || job->expected || job->insns || job->ms) {
+      fprintf(stderr, "%s:%u: job without ELF file\n", b->name, b->line);
+      exit(1);
+    }
+  }
+  return false;
+}
+
+void batch_close(struct batch_reader *b)
+{
+  fclose(b->f);
+  free(b);
+}
+
+void batch_start(uint64_t ms)
+{
+  start_ms = now_ms();
+  deadline_ms = ms ? start_ms + ms : 0;
+}
+
+bool batch_expired(void)
+{
+  return deadline_ms && now_ms() >= deadline_ms;
+}
+
+uint64_t batch_elapsed(void)
+{
+  return now_ms() - start_ms;
+}
+
+static const char *status_names[] = { "halted", "insn_limit", "timeout", "error" };
+
+static void json_string(FILE *out, const char *s, size_t len)
+{
+  fputc('"', out);
+  for (size_t i = 0; i < len; i++) {
+    unsigned char c = s[i];
+    if (c == '"' || c == '\\')
+      fprintf(out, "\\%c", c);
+    else if (c < 0x20)
+      fprintf(out, "\\u%04x", c);
+    else
+      fputc(c, out);
+  }
+  fputc('"', out);
+}
+
+/* -1: no se comprueba o no se puede leer, 0: distinta, 1: igual */
+static int output_match(const char *expected, const char *output, size_t len)
+{
+  FILE *f = fopen(expected, "rb");
+  if (f == NULL)
+    return -1;
+
+  char buf[4096];
+  size_t pos = 0, n;
+  int match = 1;
+  while (match && (n = fread(buf, 1, sizeof(buf), f)) > 0) {
+    if (n > len - pos || memcmp(buf, output + pos, n) != 0)
+      match = 0;
+    pos += n;
+  }
+  fclose(f);
+  return match && pos == len;
+}
+
+void batch_report(FILE *out, const struct batch_job *job,
+                  const struct batch_result *r, const char *output, size_t len)
+{
+  int match = -1;
+
+  fprintf(out, "{\"job\":%u,\"line\":%u,\"elf\":", ++job_count, job->line);
+  json_string(out, job->elf, strlen(job->elf));
+  fprintf(out, ",\"status\":\"%s\"", status_names[r->status]);
+  if (r->status == BATCH_ERROR) {
+    fprintf(out, ",\"error\":");
+    json_string(out, r->error, strlen(r->error));
+  } else {
+    fprintf(out, ",\"exit_code\":%" PRIi64 ",\"instructions\":%" PRIu64 ",\"ms\":%" PRIu64,
+            r->exit_code, r->instructions, r->ms);
+  }
+  if (job->expected && r->status != BATCH_ERROR) {
+    match = output_match(job->expected, output, len);
+    fprintf(out, ",\"output_match\":%s", match < 0 ? "null" : match ? "true" : "false");
+  }
+  bool passed = r->status == BATCH_HALTED && r->exit_code == 0 && match != 0;
+  if (job->expected && match < 0)
+    passed = false;
+  fprintf(out, ",\"passed\":%s}\n", passed ? "true" : "false");
+  fflush(out);
+}
+
+void batch_reply(FILE *out, const struct batch_result *r, const char *output, size_t len)
+{
+  fprintf(out, "{\"status\":\"%s\"", status_names[r->status]);
+  if (r->status == BATCH_ERROR) {
+    fprintf(out, ",\"error\":");
+    json_string(out, r->error, strlen(r->error));
+  } else {
+    fprintf(out, ",\"exit_code\":%" PRIi64 ",\"instructions\":%" PRIu64 ",\"ms\":%" PRIu64,
+            r->exit_code, r->instructions, r->ms);
+  }
+  fprintf(out, ",\"output\":");
+  json_string(out, output ? output : "", output ? len : 0);
+  fprintf(out, "}\n");
+  fflush(out);
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* Batch mode for the autograder (--batch <manifest>).
+
+   Runs every program of the manifest in the same process, one after the
+   other, each one from a clean model (model_fini/model_init, as
+   reinit_sail() does) so the start-up cost is paid once. The manifest has
+   one job per line, '#' starts a comment:
+     <elf> [input=<file>] [expected=<file>] [insns=N] [ms=N]
+   input is the stdin of the program (ecalls 5-8, /dev/null if missing),
+   expected the console output it must print, insns its instruction limit
+   (default --inst-limit, at most INT_MAX like it) and ms its wall time
+   limit (default none).
+
+   stdout only carries the results, one JSON object per job and line:
+     {"job":1,"line":3,"elf":"a.elf","status":"halted","exit_code":0,
+      "instructions":1234,"ms":2,"output_match":true,"passed":true}
+   status is halted, insn_limit, timeout or error (with "error"). The
+   messages of the simulator go to stderr, and the trace prints are
+   turned off (-v after --batch turns them on again). The ELF is checked
+   before it is loaded (a RISC-V ELF of the xlen of the model with a
+   tohost symbol), so a bad submission is an error line and the batch goes
+   on. --timing and --branch-predictor keep their configuration, only
+   their state is cleared between jobs. */
+
+struct batch_job {
+  unsigned line;
+  char *elf;
+  char *input;
+  char *expected;
+  uint64_t insns;
+  uint64_t ms;
+};
+
+enum batch_status {
+  BATCH_HALTED,
+  BATCH_INSN_LIMIT,
+  BATCH_TIMEOUT,
+  BATCH_ERROR
+};
+
+struct batch_result {
+  enum batch_status status;
+  const char *error;
+  int64_t exit_code;
+  uint64_t instructions;
+  uint64_t ms;
+};
+
+struct batch_reader;
+
+extern bool batch_mode;
+
+struct batch_reader *batch_open(const char *manifest);
+bool batch_next(struct batch_reader *b, struct batch_job *job);
+void batch_close(struct batch_reader *b);
+
+/* Wall time limit of the current job, checked by run_sail() */
+void batch_start(uint64_t ms);
+bool batch_expired(void);
+uint64_t batch_elapsed(void);
+
+/* Writes the JSON line of a job, output is what the program printed */
+void batch_report(FILE *out, const struct batch_job *job,
+                  const struct batch_result *r, const char *output, size_t len);
+
+/* Answer of --fork-server: the same fields plus the output itself */
+void batch_reply(FILE *out, const struct batch_result *r, const char *output, size_t len);
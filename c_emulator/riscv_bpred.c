@@ -0,0 +1,206 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "riscv_bpred.h"
+#include "riscv_stats.h"
+
+/* Branch predictor simulator, see riscv_bpred.h */
+
+#define BPRED_MAX_ENTRIES (1 << 20)
+
+struct btb_entry {
+  uint64_t pc;
+  uint64_t target;
+  bool valid;
+};
+
+bool bpred_enabled = false;
+bool bpred_miss = false;
+
+static enum bpred_scheme scheme = BPRED_2BIT;
+static uint32_t pht_entries = 1024;
+static uint32_t history_bits = 10;
+static uint32_t btb_entries = 64;
+
+static uint8_t *pht = NULL; /* contadores de 1 o 2 bits */
+static struct btb_entry *btb = NULL;
+static uint64_t ghr = 0;    /* historia global para gshare */
+
+static uint32_t parse_size(const char *param, const char *value, bool zero_ok)
+{
+  char *end;
+  unsigned long n = strtoul(value, &end, 0);
+  if (*value == '\0' || *end != '\0' || n > BPRED_MAX_ENTRIES
+      || (n == 0 && !zero_ok) || (n & (n - 1)) != 0) {
+    fprintf(stderr, "Invalid branch predictor parameter '%s' (power of 2 up to %d)\n",
+            param, BPRED_MAX_ENTRIES);
+    exit(1);
+  }
+  return n;
+}
+
+void bpred_init(const char *spec)
+{
+  char *copy = strdup(spec), *save = NULL;
+  char *name = strtok_r(copy, ",", &save);
+
+  if (name == NULL) {
+    fprintf(stderr, "Missing branch predictor scheme\n");
+    exit(1);
+  } else if (strcmp(name, "static") == 0) {
+    scheme = BPRED_STATIC;
+  } else if (strcmp(name, "1bit") == 0) {
+    scheme = BPRED_1BIT;
+  } else if (strcmp(name, "2bit") == 0) {
+    scheme = BPRED_2BIT;
+  } else if (strcmp(name, "gshare") == 0) {
+    scheme = BPRED_GSHARE;
+  } else {
+    fprintf(stderr, "Unknown branch predictor '%s' (static, 1bit, 2bit or gshare)\n", name);
+    exit(1);
+  }
+
+  bool history_set = false;
+  for (char *p = strtok_r(NULL, ",", &save); p; p = strtok_r(NULL, ",", &save)) {
+    char *eq = strchr(p, '=');
+    if (eq == NULL) {
+      fprintf(stderr, "Invalid branch predictor parameter '%s'\n", p);
+      exit(1);
+    }
+    *eq = '\0';
+    if (strcmp(p, "entries") == 0) {
+      pht_entries = parse_size(p, eq + 1, false);
+    } else if (strcmp(p, "btb") == 0) {
+      btb_entries = parse_size(p, eq + 1, true);
+    } else if (strcmp(p, "history") == 0) {
+      char *end;
+      history_bits = strtoul(eq + 1, &end, 0);
+      if (eq[1] == '\0' || *end != '\0' || history_bits > 32) {
+        fprintf(stderr, "Invalid branch predictor history '%s'\n", eq + 1);
+        exit(1);
+      }
+      history_set = true;
+    } else {
+      fprintf(stderr, "Unknown branch predictor parameter '%s'\n", p);
+      exit(1);
+    }
+  }
+  free(copy);
+
+  /* Por defecto gshare usa tantos bits de historia como de indice */
+  if (!history_set)
+    for (history_bits = 0; (1u << history_bits) < pht_entries; history_bits++)
+      ;
+
+  pht = calloc(pht_entries, sizeof(*pht));
+  btb = btb_entries ? calloc(btb_entries, sizeof(*btb)) : NULL;
+  if (pht == NULL || (btb_entries && btb == NULL)) {
+    fprintf(stderr, "Cannot allocate branch predictor tables\n");
+    exit(1);
+  }
+  bpred_clear();
+  bpred_enabled = true;
+}
+
+void bpred_clear(void)
+{
+  /* Empiezan en debilmente no tomado */
+  if (pht)
+    memset(pht, scheme == BPRED_1BIT ? 0 : 1, pht_entries);
+  if (btb)
+    memset(btb, 0, btb_entries * sizeof(*btb));
+  ghr = 0;
+  bpred_miss = false;
+}
+
+void bpred_reset(void)
+{
+  free(pht);
+  free(btb);
+  pht = NULL;
+  btb = NULL;
+  ghr = 0;
+  scheme = BPRED_2BIT;
+  pht_entries = 1024;
+  history_bits = 10;
+  btb_entries = 64;
+  bpred_enabled = false;
+  bpred_miss = false;
+}
+
+/* Prediccion y actualizacion de la direccion de un salto condicional */
+static bool predict_direction(uint64_t pc, uint64_t target, bool taken)
+{
+  if (scheme == BPRED_STATIC)
+    return target < pc;
+
+  uint64_t index = pc >> 1;
+  if (scheme == BPRED_GSHARE)
+    index ^= ghr;
+  uint8_t *counter = &pht[index & (pht_entries - 1)];
+
+  bool predicted;
+  if (scheme == BPRED_1BIT) {
+    predicted = *counter;
+    *counter = taken;
+  } else {
+    predicted = *counter >= 2;
+    if (taken && *counter < 3)
+      (*counter)++;
+    else if (!taken && *counter > 0)
+      (*counter)--;
+  }
+
+  if (scheme == BPRED_GSHARE && history_bits)
+    ghr = ((ghr << 1) | taken) & ((UINT64_C(1) << history_bits) - 1);
+  return predicted;
+}
+
+/* Busca y actualiza el destino de un salto tomado. Sin BTB el destino de
+   jal y de los condicionales se conoce al predecir, el de jalr nunca. */
+static bool predict_target(uint64_t pc, uint64_t target, uint8_t kind)
+{
+  if (btb == NULL)
+    return kind != 2;
+
+  struct btb_entry *e = &btb[(pc >> 1) & (btb_entries - 1)];
+  bool hit = e->valid && e->pc == pc;
+  bool correct = hit && e->target == target;
+
+  if (hit)
+    sim_stats.btb_hits++;
+  else
+    sim_stats.btb_misses++;
+  e->pc = pc;
+  e->target = target;
+  e->valid = true;
+  return correct;
+}
+
+unit branch_predict(mach_bits pc, mach_bits target, bool taken, uint8_t kind)
+{
+  if (!bpred_enabled)
+    return UNIT;
+
+  bpred_miss = false;
+  if (kind == 0) {
+    sim_stats.bpred_branches++;
+    bool predicted = predict_direction(pc, target, taken);
+    if (predicted != taken) {
+      sim_stats.bpred_dir_miss++;
+      bpred_miss = true;
+    }
+    /* El destino solo importa si se predijo y se tomo */
+    if (taken && !predict_target(pc, target, kind) && predicted) {
+      sim_stats.bpred_target_miss++;
+      bpred_miss = true;
+    }
+  } else {
+    sim_stats.bpred_jumps++;
+    if (!predict_target(pc, target, kind)) {
+      sim_stats.bpred_target_miss++;
+      bpred_miss = true;
+    }
+  }
+  return UNIT;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "sail.h"
+
+/* Branch predictor simulator (--branch-predictor <scheme>[,param=N...]).
+
+   The BTYPE, JAL and JALR execute clauses report every control transfer
+   that completes with branch_predict(); one that traps on its target
+   (misaligned, or refused by an extension) is neither counted nor
+   trains the tables. Conditional branches are predicted with one of
+   the schemes below and taken transfers look up their target in a
+   direct-mapped BTB; both tables are updated right away, O(1) per branch.
+     static  backward taken, forward not taken
+     1bit    last outcome per entry
+     2bit    bimodal saturating counters
+     gshare  2-bit counters indexed by PC xor global history
+   Parameters: entries=N (pattern table, power of 2), history=N (gshare
+   bits), btb=N (BTB entries, power of 2; 0 = target always known, except
+   for jalr).
+
+   The results are counted in struct sim_stats and, with --timing, only
+   mispredictions pay the branch penalty. */
+
+enum bpred_scheme {
+  BPRED_STATIC,
+  BPRED_1BIT,
+  BPRED_2BIT,
+  BPRED_GSHARE
+};
+
+extern bool bpred_enabled;
+extern bool bpred_miss; /* last control transfer was mispredicted */
+
+void bpred_init(const char *spec);
+void bpred_reset(void);
+/* Only the tables and the history, between --batch jobs: keeps the scheme */
+void bpred_clear(void);
+
+/* Sail extern, kind: 0 conditional branch, 1 jal, 2 jalr */
+unit branch_predict(mach_bits pc, mach_bits target, bool taken, uint8_t kind);
@@ -0,0 +1,441 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <zlib.h>
+#include "sail.h"
+#include "rts.h"
+#include "riscv_ckpt.h"
+#include "riscv_memview.h"
+#include "riscv_platform_impl.h"
+#include "riscv_sail.h"
+
+/* Checkpoints to disk, see riscv_ckpt.h */
+
+#define CKPT_MAGIC "CRCK"
+#define CKPT_VERSION 1
+#define CKPT_NAME_MAX 1024
+#define CKPT_PMP_ENTRIES 64
+#define CKPT_PMP_CFG_REGS 16
+#define CKPT_END UINT64_MAX /* fin de la lista de paginas */
+
+/* File: header, registers of ckpt_regs in order, PMP (64 pmpaddr, 16
+   pmpcfg), 32 vector registers of vlenb bytes, then [address][page] until
+   CKPT_END. Native byte order: the file is read by the same simulator. */
+struct ckpt_header {
+  char magic[4];
+  uint32_t version;
+  uint32_t xlen;
+  uint32_t regs_size; /* cambia si cambia la tabla de registros */
+  uint64_t ram_base, ram_size;
+  uint64_t chain;     /* igual en todos los checkpoints de una cadena */
+  uint64_t seq;
+  uint64_t insns;
+  uint64_t vlenb;
+  uint64_t rng[4];
+  char prev[CKPT_NAME_MAX]; /* "" en el primero de la cadena */
+};
+
+uint64_t ckpt_every = 0;
+
+static uint64_t keep = 0;
+static char *prefix = NULL;
+static uint64_t seq = 1, last_insns = 0, chain = 0;
+static char last_name[CKPT_NAME_MAX];
+static char **chain_files = NULL; /* solo con keep, para borrarlos */
+static uint64_t chain_len = 0;
+
+#define CKPT_REG(r) { &r, sizeof(r) }
+
+/* Estado del modelo que se guarda ademas de PMP y registros vectoriales */
+static const struct {
+  void *reg;
+  size_t size;
+} ckpt_regs[] = {
+  CKPT_REG(zPC), CKPT_REG(znextPC), CKPT_REG(zcur_privilege),
+  CKPT_REG(zx1), CKPT_REG(zx2), CKPT_REG(zx3), CKPT_REG(zx4),
+  CKPT_REG(zx5), CKPT_REG(zx6), CKPT_REG(zx7), CKPT_REG(zx8),
+  CKPT_REG(zx9), CKPT_REG(zx10), CKPT_REG(zx11), CKPT_REG(zx12),
+  CKPT_REG(zx13), CKPT_REG(zx14), CKPT_REG(zx15), CKPT_REG(zx16),
+  CKPT_REG(zx17), CKPT_REG(zx18), CKPT_REG(zx19), CKPT_REG(zx20),
+  CKPT_REG(zx21), CKPT_REG(zx22), CKPT_REG(zx23), CKPT_REG(zx24),
+  CKPT_REG(zx25), CKPT_REG(zx26), CKPT_REG(zx27), CKPT_REG(zx28),
+  CKPT_REG(zx29), CKPT_REG(zx30), CKPT_REG(zx31),
+  CKPT_REG(zf0), CKPT_REG(zf1), CKPT_REG(zf2), CKPT_REG(zf3),
+  CKPT_REG(zf4), CKPT_REG(zf5), CKPT_REG(zf6), CKPT_REG(zf7),
+  CKPT_REG(zf8), CKPT_REG(zf9), CKPT_REG(zf10), CKPT_REG(zf11),
+  CKPT_REG(zf12), CKPT_REG(zf13), CKPT_REG(zf14), CKPT_REG(zf15),
+  CKPT_REG(zf16), CKPT_REG(zf17), CKPT_REG(zf18), CKPT_REG(zf19),
+  CKPT_REG(zf20), CKPT_REG(zf21), CKPT_REG(zf22), CKPT_REG(zf23),
+  CKPT_REG(zf24), CKPT_REG(zf25), CKPT_REG(zf26), CKPT_REG(zf27),
+  CKPT_REG(zf28), CKPT_REG(zf29), CKPT_REG(zf30), CKPT_REG(zf31),
+  CKPT_REG(zfcsr),
+  CKPT_REG(zmisa), CKPT_REG(zmstatus), CKPT_REG(zmstatush),
+  CKPT_REG(zmtvec), CKPT_REG(zmepc), CKPT_REG(zmcause), CKPT_REG(zmtval),
+  CKPT_REG(zmscratch), CKPT_REG(zmie), CKPT_REG(zmip), CKPT_REG(zmideleg),
+  CKPT_REG(zmedeleg), CKPT_REG(zmhartid), CKPT_REG(zmcounteren),
+  CKPT_REG(zscounteren), CKPT_REG(zmcountinhibit), CKPT_REG(zmenvcfg),
+  CKPT_REG(zmcycle), CKPT_REG(zminstret), CKPT_REG(zmtime),
+  CKPT_REG(zmtimecmp), CKPT_REG(ztselect),
+  CKPT_REG(zsedeleg), CKPT_REG(zsideleg), CKPT_REG(zstvec),
+  CKPT_REG(zsepc), CKPT_REG(zscause), CKPT_REG(zstval),
+  CKPT_REG(zsscratch), CKPT_REG(zsenvcfg), CKPT_REG(zsatp),
+  CKPT_REG(zvstart), CKPT_REG(zvxsat), CKPT_REG(zvxrm), CKPT_REG(zvl),
+  CKPT_REG(zvtype), CKPT_REG(zvcsr),
+  CKPT_REG(zhtif_tohost), CKPT_REG(zhtif_done), CKPT_REG(zhtif_exit_code),
+  CKPT_REG(zhtif_cmd_write), CKPT_REG(zhtif_payload_writes),
+};
+
+#define CKPT_NREGS (sizeof(ckpt_regs) / sizeof(ckpt_regs[0]))
+
+static sail_bits *const vregs[32] = {
+  &zvr0,  &zvr1,  &zvr2,  &zvr3,  &zvr4,  &zvr5,  &zvr6,  &zvr7,
+  &zvr8,  &zvr9,  &zvr10, &zvr11, &zvr12, &zvr13, &zvr14, &zvr15,
+  &zvr16, &zvr17, &zvr18, &zvr19, &zvr20, &zvr21, &zvr22, &zvr23,
+  &zvr24, &zvr25, &zvr26, &zvr27, &zvr28, &zvr29, &zvr30, &zvr31
+};
+
+static uint32_t regs_size(void)
+{
+  uint32_t size = 0;
+  for (size_t i = 0; i < CKPT_NREGS; i++)
+    size += ckpt_regs[i].size;
+  return size;
+}
+
+void ckpt_init(const char *spec)
+{
+  char *copy = strdup(spec);
+  for (char *tok = strtok(copy, ","); tok; tok = strtok(NULL, ",")) {
+    char *end;
+    if (strncmp(tok, "keep=", 5) == 0) {
+      keep = strtoull(tok + 5, &end, 0);
+      if (*end != '\0') {
+        fprintf(stderr, "Invalid checkpoint keep '%s'\n", tok + 5);
+        exit(1);
+      }
+    } else if (strncmp(tok, "prefix=", 7) == 0) {
+      free(prefix);
+      prefix = strdup(tok + 7);
+    } else {
+      ckpt_every = strtoull(tok, &end, 0);
+      if (*end != '\0' || ckpt_every == 0) {
+        fprintf(stderr, "Invalid checkpoint interval '%s'\n", tok);
+        exit(1);
+      }
+    }
+  }
+  free(copy);
+  if (ckpt_every == 0) {
+    fprintf(stderr, "--checkpoint needs an interval in instructions\n");
+    exit(1);
+  }
+  if (prefix == NULL)
+    prefix = strdup("ckpt");
+  if (strlen(prefix) > CKPT_NAME_MAX - 32) {
+    fprintf(stderr, "Checkpoint prefix too long '%s'\n", prefix);
+    exit(1);
+  }
+}
+
+/* Olvida la cadena actual; chain_files solo existe con keep */
+static void drop_chain(bool remove_files)
+{
+  for (uint64_t i = 0; chain_files && i < chain_len; i++) {
+    if (remove_files)
+      unlink(chain_files[i]);
+    free(chain_files[i]);
+  }
+  free(chain_files);
+  chain_files = NULL;
+  chain_len = 0;
+}
+
+void ckpt_reset(void)
+{
+  drop_chain(false);
+  free(prefix);
+  prefix = NULL;
+  ckpt_every = 0;
+  keep = 0;
+  seq = 1;
+  last_insns = 0;
+  chain = 0;
+}
+
+static void put(gzFile f, const void *buf, size_t len, const char *name)
+{
+  if (len && gzwrite(f, buf, len) != (int)len) {
+    fprintf(stderr, "Cannot write checkpoint '%s'\n", name);
+    exit(1);
+  }
+}
+
+static void get(gzFile f, void *buf, size_t len, const char *name)
+{
+  if (len && gzread(f, buf, len) != (int)len) {
+    fprintf(stderr, "Checkpoint '%s' is truncated or corrupt\n", name);
+    exit(1);
+  }
+}
+
+static void save_vregs(gzFile f, const char *name)
+{
+  uint8_t *buf = malloc(zvlenb ? zvlenb : 1);
+  mpz_t tmp;
+  if (buf == NULL) {
+    fprintf(stderr, "Cannot allocate checkpoint buffer\n");
+    exit(1);
+  }
+  mpz_init(tmp);
+  for (int i = 0; i < 32; i++) {
+    size_t count;
+    memset(buf, 0, zvlenb);
+    mpz_tdiv_r_2exp(tmp, *vregs[i]->bits, zvlenb * 8);
+    mpz_export(buf, &count, -1, 1, -1, 0, tmp);
+    put(f, buf, zvlenb, name);
+  }
+  mpz_clear(tmp);
+  free(buf);
+}
+
+static void save(uint64_t insns)
+{
+  static uint8_t page[MEMVIEW_PAGE_SIZE];
+  struct ckpt_header h;
+  char name[CKPT_NAME_MAX], tmp[CKPT_NAME_MAX + 4];
+  bool first = chain_len == 0 || (keep && chain_len >= keep);
+  enum memview_user pages_of = first ? MEMVIEW_CKPT_LOAD : MEMVIEW_CKPT;
+  uint64_t written = 0;
+
+  snprintf(name, sizeof(name), "%s-%06" PRIu64 ".ckpt", prefix, seq);
+  snprintf(tmp, sizeof(tmp), "%s.tmp", name);
+  gzFile f = gzopen(tmp, "wb1");
+  if (f == NULL) {
+    fprintf(stderr, "Cannot create checkpoint '%s'\n", tmp);
+    exit(1);
+  }
+
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, CKPT_MAGIC, 4);
+  h.version = CKPT_VERSION;
+  h.xlen = zxlen_val;
+  h.regs_size = regs_size();
+  h.ram_base = rv_ram_base;
+  h.ram_size = rv_ram_size;
+  if (first)
+    chain = (uint64_t)time(NULL) << 24 ^ (uint64_t)getpid() << 8 ^ seq;
+  h.chain = chain;
+  h.seq = seq;
+  h.insns = insns;
+  h.vlenb = zvlenb;
+  memcpy(h.rng, rv_random_state(), sizeof(h.rng));
+  if (!first)
+    strcpy(h.prev, last_name);
+  put(f, &h, sizeof(h), tmp);
+
+  for (size_t i = 0; i < CKPT_NREGS; i++)
+    put(f, ckpt_regs[i].reg, ckpt_regs[i].size, tmp);
+  for (int i = 0; i < CKPT_PMP_ENTRIES; i++) {
+    mach_bits v = zpmpReadAddrReg(i);
+    put(f, &v, sizeof(v), tmp);
+  }
+  for (int i = 0; i < CKPT_PMP_CFG_REGS; i++) {
+    /* En RV64 solo existen los pares */
+    mach_bits v = (zxlen_val == 32 || i % 2 == 0) ? zpmpReadCfgReg(i) : 0;
+    put(f, &v, sizeof(v), tmp);
+  }
+  save_vregs(f, tmp);
+
+  for (uint64_t p = 0; p < memview_pages(); p++) {
+    if (!memview_dirty(pages_of, p))
+      continue;
+    uint64_t addr = memview_page_addr(p);
+    for (uint64_t i = 0; i < MEMVIEW_PAGE_SIZE; i++)
+      page[i] = (uint8_t)read_mem(addr + i);
+    put(f, &addr, sizeof(addr), tmp);
+    put(f, page, sizeof(page), tmp);
+    written++;
+  }
+  uint64_t end = CKPT_END;
+  put(f, &end, sizeof(end), tmp);
+  if (gzclose(f) != Z_OK || rename(tmp, name) != 0) {
+    fprintf(stderr, "Cannot write checkpoint '%s'\n", name);
+    exit(1);
+  }
+  memview_clear(MEMVIEW_CKPT);
+
+  /* La cadena anterior ya no hace falta */
+  if (first)
+    drop_chain(keep);
+  if (keep) {
+    chain_files = realloc(chain_files, (chain_len + 1) * sizeof(char *));
+    chain_files[chain_len] = strdup(name);
+  }
+  chain_len++;
+  strcpy(last_name, name);
+  seq++;
+
+  fprintf(stderr, "Checkpoint %s: %" PRIu64 " instructions, %" PRIu64 " pages\n",
+          name, insns, written);
+}
+
+void ckpt_step(uint64_t insns)
+{
+  if (insns - last_insns < ckpt_every)
+    return;
+  save(insns);
+  last_insns = insns;
+}
+
+static gzFile open_ckpt(const char *name, struct ckpt_header *h)
+{
+  gzFile f = gzopen(name, "rb");
+  if (f == NULL) {
+    fprintf(stderr, "Cannot open checkpoint '%s'\n", name);
+    exit(1);
+  }
+  get(f, h, sizeof(*h), name);
+  if (memcmp(h->magic, CKPT_MAGIC, 4) != 0 || h->version != CKPT_VERSION) {
+    fprintf(stderr, "'%s' is not a checkpoint (version %d)\n", name, CKPT_VERSION);
+    exit(1);
+  }
+  if (h->xlen != zxlen_val || h->regs_size != regs_size()
+      || h->ram_base != rv_ram_base || h->ram_size != rv_ram_size
+      || h->vlenb != zvlenb) {
+    fprintf(stderr, "Checkpoint '%s' was written by a different model or configuration\n", name);
+    exit(1);
+  }
+  h->prev[CKPT_NAME_MAX - 1] = '\0';
+  return f;
+}
+
+static void restore_regs(gzFile f, const char *name)
+{
+  mach_bits addr[CKPT_PMP_ENTRIES], cfg[CKPT_PMP_CFG_REGS];
+  uint8_t *buf = malloc(zvlenb ? zvlenb : 1);
+  if (buf == NULL) {
+    fprintf(stderr, "Cannot allocate checkpoint buffer\n");
+    exit(1);
+  }
+
+  for (size_t i = 0; i < CKPT_NREGS; i++)
+    get(f, ckpt_regs[i].reg, ckpt_regs[i].size, name);
+
+  /* Las direcciones antes que las configuraciones, que pueden bloquearlas */
+  get(f, addr, sizeof(addr), name);
+  get(f, cfg, sizeof(cfg), name);
+  for (int i = 0; i < CKPT_PMP_ENTRIES; i++)
+    zpmpWriteAddrReg(i, addr[i]);
+  for (int i = 0; i < CKPT_PMP_CFG_REGS; i++)
+    if (zxlen_val == 32 || i % 2 == 0)
+      zpmpWriteCfgReg(i, cfg[i]);
+
+  for (int i = 0; i < 32; i++) {
+    get(f, buf, zvlenb, name);
+    mpz_import(*vregs[i]->bits, zvlenb, -1, 1, -1, 0, buf);
+  }
+  free(buf);
+  zinit_TLB(UNIT);
+}
+
+static void skip_regs(gzFile f, const char *name)
+{
+  size_t len = regs_size() + (CKPT_PMP_ENTRIES + CKPT_PMP_CFG_REGS) * sizeof(mach_bits)
+      + 32 * zvlenb;
+  if (gzseek(f, len, SEEK_CUR) < 0) {
+    fprintf(stderr, "Checkpoint '%s' is truncated or corrupt\n", name);
+    exit(1);
+  }
+}
+
+static uint64_t restore_pages(gzFile f, const char *name)
+{
+  static uint8_t page[MEMVIEW_PAGE_SIZE];
+  uint64_t addr, n = 0;
+
+  for (;;) {
+    get(f, &addr, sizeof(addr), name);
+    if (addr == CKPT_END)
+      return n;
+    if (addr < rv_ram_base || addr - rv_ram_base >= rv_ram_size
+        || (addr - rv_ram_base) % MEMVIEW_PAGE_SIZE) {
+      fprintf(stderr, "Checkpoint '%s' is truncated or corrupt\n", name);
+      exit(1);
+    }
+    get(f, page, sizeof(page), name);
+    for (uint64_t i = 0; i < MEMVIEW_PAGE_SIZE; i++)
+      write_mem(addr + i, page[i]);
+    /* El siguiente primero de cadena tambien tiene que llevarla */
+    memview_write(addr, MEMVIEW_PAGE_SIZE);
+    n++;
+  }
+}
+
+uint64_t ckpt_restore(const char *path)
+{
+  struct ckpt_header h, top;
+  char **names = NULL, name[CKPT_NAME_MAX];
+  uint64_t count = 0, pages = 0;
+
+  if (strlen(path) >= sizeof(name)) {
+    fprintf(stderr, "Checkpoint name too long '%s'\n", path);
+    exit(1);
+  }
+  strcpy(name, path);
+
+  /* Cabeceras desde el ultimo hasta el primero de la cadena */
+  for (;;) {
+    gzFile f = open_ckpt(name, &h);
+    gzclose(f);
+    if (count > 0 && (h.chain != top.chain || h.seq + count != top.seq)) {
+      fprintf(stderr, "Checkpoint '%s' does not belong to the chain of '%s'\n",
+              name, path);
+      exit(1);
+    }
+    if (count == 0)
+      top = h;
+    names = realloc(names, (count + 1) * sizeof(char *));
+    names[count++] = strdup(name);
+    if (h.prev[0] == '\0')
+      break;
+    strcpy(name, h.prev);
+  }
+
+  for (uint64_t i = count; i-- > 0;) {
+    gzFile f = open_ckpt(names[i], &h);
+    if (i == 0)
+      restore_regs(f, names[i]);
+    else
+      skip_regs(f, names[i]);
+    pages += restore_pages(f, names[i]);
+    gzclose(f);
+  }
+
+  memcpy(rv_random_state(), top.rng, sizeof(top.rng));
+  seq = top.seq + 1;
+  last_insns = top.insns;
+
+  /* Los siguientes checkpoints continuan la cadena restaurada: con keep se
+     borran sus ficheros al empezar la siguiente, como si los hubiera escrito
+     esta ejecucion */
+  drop_chain(false);
+  for (uint64_t i = count; i-- > 0;) {
+    if (keep) {
+      chain_files = realloc(chain_files, (chain_len + 1) * sizeof(char *));
+      chain_files[chain_len] = strdup(names[i]);
+    }
+    chain_len++;
+  }
+  chain = top.chain;
+  strcpy(last_name, path);
+  memview_clear(MEMVIEW_CKPT); /* las paginas ya estan en la cadena */
+  fprintf(stderr, "Restored %s: %" PRIu64 " instructions, %" PRIu64
+          " checkpoints, %" PRIu64 " pages\n", path, top.insns, count, pages);
+
+  for (uint64_t i = 0; i < count; i++)
+    free(names[i]);
+  free(names);
+  return top.insns;
+}
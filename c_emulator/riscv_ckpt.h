@@ -0,0 +1,34 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Checkpoints to disk (--checkpoint N[,keep=K][,prefix=P], --restore <file>).
+
+   Every N instructions (rounded up to the next clock tick, so a restored
+   run ticks at the same instructions) the model state is written to
+   P-<number>.ckpt, compressed with zlib: the architectural registers and
+   CSRs, PMP, vector registers, mtime/mtimecmp, HTIF, the random generator
+   and the RAM pages written since the previous checkpoint (riscv_memview.h).
+   The first checkpoint has every page written since the ELF was loaded and
+   starts a chain; the next ones only name their predecessor. With keep=K a
+   new chain is started every K checkpoints and the files of the previous
+   chain are deleted, so at most K are kept (default: all, one chain).
+
+   --restore loads the ELF files and initializes the model as usual, then
+   applies the pages of every checkpoint of the chain and the registers of
+   the last one; the checkpoints written afterwards continue that chain
+   (and with keep=K delete its files like their own). It needs the same ELF files and options (xlen, RAM) as the
+   run that wrote it. Not restored: TLB (flushed), LR/SC reservations, the
+   cache simulator and the statistics of the harness (counted again from
+   the restore). Not available with --batch, --fork-server or --harts. */
+
+extern uint64_t ckpt_every; /* 0: sin checkpoints */
+
+void ckpt_init(const char *spec);
+void ckpt_reset(void);
+
+/* Called from run_sail() after each clock tick */
+void ckpt_step(uint64_t insns);
+
+/* After init_sail(); returns the instructions retired before the checkpoint */
+uint64_t ckpt_restore(const char *path);
@@ -0,0 +1,150 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "riscv_console.h"
+#ifdef WEBSIM
+  #include <emscripten.h>
+#else
+  #define EMSCRIPTEN_KEEPALIVE
+#endif
+
+/* Buffered console for the guest output, see riscv_console.h */
+
+static char *console_buf = NULL;
+static size_t console_len = 0;
+static size_t console_cap = 0;
+static FILE *console_out = NULL;
+
+static void console_reserve(size_t extra)
+{
+  if (console_len + extra <= console_cap)
+    return;
+
+  size_t cap = console_cap ? console_cap : 4096;
+  while (cap < console_len + extra)
+    cap *= 2;
+
+  char *buf = realloc(console_buf, cap);
+  if (buf == NULL) {
+    fprintf(stderr, "Cannot grow console buffer to %zu bytes\n", cap);
+    exit(1);
+  }
+  console_buf = buf;
+  console_cap = cap;
+}
+
+void console_write(const char *data, size_t len)
+{
+  console_reserve(len);
+  memcpy(console_buf + console_len, data, len);
+  console_len += len;
+
+  if (console_len >= CONSOLE_FLUSH_THRESHOLD)
+    console_flush();
+}
+
+void console_printf(const char *fmt, ...)
+{
+  char line[128];
+  va_list ap;
+
+  va_start(ap, fmt);
+  int n = vsnprintf(line, sizeof(line), fmt, ap);
+  va_end(ap);
+  if (n < 0)
+    return;
+
+  if ((size_t)n < sizeof(line)) {
+    console_write(line, n);
+  } else {
+    console_reserve(n + 1);
+    va_start(ap, fmt);
+    vsnprintf(console_buf + console_len, n + 1, fmt, ap);
+    va_end(ap);
+    console_len += n;
+    if (console_len >= CONSOLE_FLUSH_THRESHOLD)
+      console_flush();
+  }
+}
+
+/* Hands the pending output to the host. In the browser the page may install
+   Module.onConsoleFlush(ptr, len) to read the whole block at once (one DOM
+   update); otherwise the block goes to stdout with a single write. */
+void console_flush(void)
+{
+  if (console_len == 0)
+    return;
+
+#ifdef WEBSIM
+  int drained = EM_ASM_INT({
+    if (typeof Module.onConsoleFlush !== "function")
+      return 0;
+    Module.onConsoleFlush($0, $1);
+    return 1;
+  }, console_buf, console_len);
+  if (drained) {
+    console_len = 0;
+    return;
+  }
+#endif
+
+  FILE *out = console_out ? console_out : stdout;
+  fwrite(console_buf, 1, console_len, out);
+  fflush(out);
+  console_len = 0;
+}
+
+void model_printf(const char *fmt, ...)
+{
+  va_list ap;
+
+  console_flush();
+  va_start(ap, fmt);
+  vprintf(fmt, ap);
+  va_end(ap);
+}
+
+void console_set_output(FILE *f)
+{
+  console_out = f;
+}
+
+EMSCRIPTEN_KEEPALIVE char *console_data(void)
+{
+  return console_buf;
+}
+
+EMSCRIPTEN_KEEPALIVE uint32_t console_length(void)
+{
+  return console_len;
+}
+
+EMSCRIPTEN_KEEPALIVE void console_clear(void)
+{
+  console_len = 0;
+}
+
+/* ecall 1 */
+unit print_guest_int(mach_bits value)
+{
+#ifdef RV32
+  int64_t v = (int32_t)value;
+#else
+  int64_t v = (int64_t)value;
+#endif
+  if (v == 0)
+    console_printf("ECALL UNSIGNED: 0\n");
+  else
+    console_printf("ECALL SIGNED: %lld\n", (long long)v);
+  return UNIT;
+}
+
+/* ecall 11 */
+unit print_guest_char(mach_bits c)
+{
+  char line[] = "ECALL CHAR: ?\n";
+  line[12] = (char)c;
+  console_write(line, sizeof(line) - 1);
+  return UNIT;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "sail.h"
+
+/* Console for the guest output (ecalls 1-4 and 11).
+
+   The text is kept in a growable buffer and handed to the host in bulk
+   instead of one printf per ecall. The buffer is flushed only when the
+   simulator yields (step by step), halts, waits for user input or when it
+   grows past CONSOLE_FLUSH_THRESHOLD.
+
+   Everything else the model writes to stdout (traces, register dumps,
+   cache messages, SUCCESS/FAILURE) flushes the buffer first, so the host
+   sees both in program order: model_printf() in the harness and the
+   print_* macros of riscv_prelude.h for the prints of the Sail runtime. */
+
+#define CONSOLE_FLUSH_THRESHOLD (64 * 1024)
+
+void console_write(const char *data, size_t len);
+void console_printf(const char *fmt, ...);
+void console_flush(void);
+
+/* printf to stdout after the pending console text */
+void model_printf(const char *fmt, ...);
+
+/* Where console_flush() writes outside the browser, NULL for stdout */
+void console_set_output(FILE *f);
+
+/* Host side: the IDE can drain the buffer directly from linear memory */
+char *console_data(void);
+uint32_t console_length(void);
+void console_clear(void);
+
+/* Sail externs */
+unit print_guest_int(mach_bits value);
+unit print_guest_char(mach_bits c);
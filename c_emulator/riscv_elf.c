@@ -0,0 +1,321 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "sail.h"
+#include "rts.h"
+#include "riscv_elf.h"
+
+/* ELF loader, see riscv_elf.h */
+
+#define EM_RISCV 243
+#define PT_LOAD 1
+#define SHT_SYMTAB 2
+#define SHF_EXECINSTR 0x4
+
+struct elf_sym {
+  const char *name; /* dentro del fichero mapeado */
+  uint64_t value;
+};
+
+struct elf_file {
+  const char *path;
+  const uint8_t *buf;
+  size_t len;
+  bool is64;
+  uint64_t entry;
+  struct elf_sym *syms; /* direccionamiento abierto, name == NULL vacio */
+  uint32_t syms_cap;
+  /* .symtab para elf_next_symbol() */
+  uint64_t shoff, shentsize, shnum;
+  uint64_t symoff, nsyms, stroff, strsize;
+  const char **error; /* dentro de elf_try_open(), NULL despues */
+};
+
+/* En elf_try_open() se guarda el primer error y se sigue con lecturas a
+   cero hasta poder volver; despues sale como siempre */
+static void elf_error(const struct elf_file *elf, const char *msg)
+{
+  if (elf->error) {
+    if (*elf->error == NULL)
+      *elf->error = msg;
+    return;
+  }
+  fprintf(stderr, "%s: %s\n", elf->path, msg);
+  exit(1);
+}
+
+/* Lectura little endian con comprobacion de limites */
+static uint64_t rd(const struct elf_file *elf, uint64_t off, size_t size)
+{
+  uint64_t v = 0;
+  if (off > elf->len || size > elf->len - off) {
+    elf_error(elf, "truncated ELF file");
+    return 0;
+  }
+  for (size_t i = size; i > 0; i--)
+    v = (v << 8) | elf->buf[off + i - 1];
+  return v;
+}
+
+/* Campo de 32 o 64 bits segun la clase del fichero */
+#define RD_ADDR(elf, off32, off64) \
+  ((elf)->is64 ? rd(elf, off64, 8) : rd(elf, off32, 4))
+
+static uint32_t hash_name(const char *s)
+{
+  uint32_t h = 2166136261u; /* FNV-1a */
+  for (; *s; s++)
+    h = (h ^ (uint8_t)*s) * 16777619u;
+  return h;
+}
+
+static void add_symbol(struct elf_file *elf, const char *name, uint64_t value)
+{
+  uint32_t mask = elf->syms_cap - 1;
+  for (uint32_t i = hash_name(name) & mask;; i = (i + 1) & mask) {
+    if (elf->syms[i].name == NULL) {
+      elf->syms[i].name = name;
+      elf->syms[i].value = value;
+      return;
+    }
+    if (strcmp(elf->syms[i].name, name) == 0)
+      return; /* como lookup_sym(): el primero de la tabla */
+  }
+}
+
+/* Nombre de un simbolo de .symtab, NULL si no tiene */
+static const char *symbol_name(const struct elf_file *elf, uint64_t sym)
+{
+  uint64_t name = rd(elf, sym, 4);
+  if (name == 0 || name >= elf->strsize
+      || memchr(elf->buf + elf->stroff + name, 0, elf->strsize - name) == NULL)
+    return NULL;
+  return (const char *)elf->buf + elf->stroff + name;
+}
+
+static void read_symbols(struct elf_file *elf)
+{
+  uint64_t shoff = RD_ADDR(elf, 0x20, 0x28);
+  uint64_t shentsize = rd(elf, elf->is64 ? 0x3A : 0x2E, 2);
+  uint64_t shnum = rd(elf, elf->is64 ? 0x3C : 0x30, 2);
+  elf->shoff = shoff;
+  elf->shentsize = shentsize;
+  elf->shnum = shnum;
+
+  for (uint64_t s = 0; s < shnum; s++) {
+    uint64_t sh = shoff + s * shentsize;
+    if (rd(elf, sh + 4, 4) != SHT_SYMTAB)
+      continue;
+    if (shoff > elf->len || shnum * shentsize > elf->len - shoff) {
+      elf_error(elf, "truncated ELF file");
+      return;
+    }
+
+    uint64_t symoff = RD_ADDR(elf, sh + 16, sh + 24);
+    uint64_t symsize = RD_ADDR(elf, sh + 20, sh + 32);
+    uint64_t link = rd(elf, sh + (elf->is64 ? 40 : 24), 4);
+    uint64_t stroff = RD_ADDR(elf, shoff + link * shentsize + 16, shoff + link * shentsize + 24);
+    uint64_t strsize = RD_ADDR(elf, shoff + link * shentsize + 20, shoff + link * shentsize + 32);
+    uint64_t entsize = elf->is64 ? 24 : 16;
+    uint64_t nsyms = symsize / entsize;
+    if (stroff > elf->len || strsize > elf->len - stroff
+        || symoff > elf->len || symsize > elf->len - symoff) {
+      elf_error(elf, "truncated ELF file");
+      return;
+    }
+    elf->symoff = symoff;
+    elf->nsyms = nsyms;
+    elf->stroff = stroff;
+    elf->strsize = strsize;
+
+    elf->syms_cap = 16;
+    while (elf->syms_cap < 2 * nsyms)
+      elf->syms_cap *= 2;
+    elf->syms = calloc(elf->syms_cap, sizeof(struct elf_sym));
+    if (elf->syms == NULL) {
+      fprintf(stderr, "Cannot allocate ELF symbol table\n");
+      exit(1);
+    }
+    for (uint64_t i = 0; i < nsyms; i++) {
+      uint64_t sym = symoff + i * entsize;
+      const char *name = symbol_name(elf, sym);
+      if (name)
+        add_symbol(elf, name, RD_ADDR(elf, sym + 4, sym + 8));
+    }
+    return;
+  }
+}
+
+/* Recorre los PT_LOAD; sin write solo comprueba que estan en el fichero */
+static uint64_t load_segments(const struct elf_file *elf, bool write)
+{
+  uint64_t phoff = RD_ADDR(elf, 0x1C, 0x20);
+  uint64_t phentsize = rd(elf, elf->is64 ? 0x36 : 0x2A, 2);
+  uint64_t phnum = rd(elf, elf->is64 ? 0x38 : 0x2C, 2);
+  uint64_t written = 0;
+
+  for (uint64_t p = 0; p < phnum; p++) {
+    uint64_t ph = phoff + p * phentsize;
+    if (rd(elf, ph, 4) != PT_LOAD)
+      continue;
+
+    uint64_t offset = RD_ADDR(elf, ph + 4, ph + 8);
+    uint64_t paddr = RD_ADDR(elf, ph + 12, ph + 24);
+    uint64_t filesz = RD_ADDR(elf, ph + 16, ph + 32);
+    if (offset > elf->len || filesz > elf->len - offset) {
+      elf_error(elf, "segment past the end of the file");
+      continue;
+    }
+    if (!write)
+      continue;
+
+    const uint8_t *data = elf->buf + offset;
+    for (uint64_t i = 0; i < filesz; i++)
+      write_mem(paddr + i, data[i]);
+    written += filesz;
+  }
+  return written;
+}
+
+struct elf_file *elf_try_open(const char *path, const char **error)
+{
+  struct elf_file *elf = calloc(1, sizeof(*elf));
+  struct stat st;
+  if (elf == NULL) {
+    fprintf(stderr, "Cannot allocate ELF file\n");
+    exit(1);
+  }
+  elf->path = path;
+  *error = NULL;
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0 || fstat(fd, &st) < 0) {
+    if (fd >= 0)
+      close(fd);
+    free(elf);
+    *error = "unable to open file";
+    return NULL;
+  }
+  elf->len = st.st_size;
+  if (elf->len < 0x34) {
+    close(fd);
+    free(elf);
+    *error = "not an ELF file";
+    return NULL;
+  }
+  void *map = mmap(NULL, elf->len, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    free(elf);
+    *error = "unable to map file";
+    return NULL;
+  }
+  elf->buf = map;
+  elf->error = error;
+
+  if (memcmp(elf->buf, "\177ELF", 4) != 0)
+    elf_error(elf, "not an ELF file");
+  else if (elf->buf[4] != 1 && elf->buf[4] != 2)
+    elf_error(elf, "unknown ELF class");
+  else if (elf->buf[5] != 1)
+    elf_error(elf, "not a little endian ELF file");
+  else {
+    elf->is64 = elf->buf[4] == 2;
+    if (rd(elf, 0x12, 2) != EM_RISCV)
+      elf_error(elf, "not a RISC-V ELF file");
+    elf->entry = RD_ADDR(elf, 0x18, 0x18);
+  }
+  if (*error == NULL)
+    read_symbols(elf);
+  if (*error == NULL)
+    load_segments(elf, false);
+
+  elf->error = NULL;
+  if (*error != NULL) {
+    elf_close(elf);
+    return NULL;
+  }
+  return elf;
+}
+
+struct elf_file *elf_open(const char *path)
+{
+  const char *error;
+  struct elf_file *elf = elf_try_open(path, &error);
+  if (elf == NULL) {
+    fprintf(stderr, "%s: %s\n", path, error);
+    exit(1);
+  }
+  return elf;
+}
+
+void elf_close(struct elf_file *elf)
+{
+  munmap((void *)elf->buf, elf->len);
+  free(elf->syms);
+  free(elf);
+}
+
+bool elf_is32bit(const struct elf_file *elf)
+{
+  return !elf->is64;
+}
+
+uint64_t elf_entry(const struct elf_file *elf)
+{
+  return elf->entry;
+}
+
+uint64_t elf_load(const struct elf_file *elf)
+{
+  return load_segments(elf, true);
+}
+
+bool elf_symbol(const struct elf_file *elf, const char *name, uint64_t *value)
+{
+  if (elf->syms == NULL)
+    return false;
+
+  uint32_t mask = elf->syms_cap - 1;
+  for (uint32_t i = hash_name(name) & mask; elf->syms[i].name; i = (i + 1) & mask)
+    if (strcmp(elf->syms[i].name, name) == 0) {
+      *value = elf->syms[i].value;
+      return true;
+    }
+  return false;
+}
+
+bool elf_next_symbol(const struct elf_file *elf, uint64_t *index,
+                     struct elf_sym_info *info)
+{
+  uint64_t entsize = elf->is64 ? 24 : 16;
+
+  for (; *index < elf->nsyms; (*index)++) {
+    uint64_t sym = elf->symoff + *index * entsize;
+    const char *name = symbol_name(elf, sym);
+    if (name == NULL)
+      continue;
+
+    uint8_t st_info = rd(elf, sym + (elf->is64 ? 4 : 12), 1);
+    uint64_t shndx = rd(elf, sym + (elf->is64 ? 6 : 14), 2);
+    info->name = name;
+    info->value = RD_ADDR(elf, sym + 4, sym + 8);
+    info->size = RD_ADDR(elf, sym + 8, sym + 16);
+    info->type = st_info & 0xf;
+    info->bind = st_info >> 4;
+    info->exec = false;
+    info->section_end = 0;
+    if (shndx != 0 && shndx < elf->shnum) { /* ni SHN_UNDEF ni especiales */
+      uint64_t sh = elf->shoff + shndx * elf->shentsize;
+      info->exec = (RD_ADDR(elf, sh + 8, sh + 8) & SHF_EXECINSTR) != 0;
+      info->section_end = RD_ADDR(elf, sh + 12, sh + 16) + RD_ADDR(elf, sh + 20, sh + 32);
+    }
+    (*index)++;
+    return true;
+  }
+  return false;
+}
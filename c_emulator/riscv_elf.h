@@ -0,0 +1,45 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* ELF loader of the harness, used by load_sail() instead of load_elf() and
+   lookup_sym() of the Sail runtime, which parse the file again for every
+   symbol.
+
+   elf_open() maps the file once and builds a hash table of the symbols of
+   .symtab; elf_symbol() is then O(1). elf_load() writes the file part of
+   every PT_LOAD segment to its physical address. The .bss part is not
+   written: the memory of the runtime is sparse and reads as zero until it
+   is written, and the model starts from an empty memory on every
+   model_init() (also between --batch jobs), so it is zero already. */
+
+struct elf_file;
+
+/* Exits with a message if the file cannot be read or is not a RISC-V ELF */
+struct elf_file *elf_open(const char *path);
+/* The same checks (also that every PT_LOAD segment is in the file), but
+   returns NULL and the reason in *error, for --batch */
+struct elf_file *elf_try_open(const char *path, const char **error);
+void elf_close(struct elf_file *elf);
+
+bool elf_is32bit(const struct elf_file *elf);
+uint64_t elf_entry(const struct elf_file *elf);
+
+/* Returns the number of bytes written to memory */
+uint64_t elf_load(const struct elf_file *elf);
+
+bool elf_symbol(const struct elf_file *elf, const char *name, uint64_t *value);
+
+/* Symbols of .symtab in file order, for the profiler (riscv_profile.c).
+   Start with *index = 0; unnamed symbols are skipped. */
+struct elf_sym_info {
+  const char *name;     /* valid until elf_close() */
+  uint64_t value, size;
+  uint8_t type, bind;   /* STT_*, STB_* */
+  bool exec;            /* defined in an SHF_EXECINSTR section */
+  uint64_t section_end; /* end address of that section, 0 if undefined */
+};
+
+bool elf_next_symbol(const struct elf_file *elf, uint64_t *index,
+                     struct elf_sym_info *info);
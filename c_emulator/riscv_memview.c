@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "sail.h"
+#include "rts.h"
+#include "riscv_memview.h"
+#ifdef WEBSIM
+  #include <emscripten.h>
+#else
+  #define EMSCRIPTEN_KEEPALIVE
+#endif
+
+/* Guest memory viewer, see riscv_memview.h */
+
+bool memview_attached = false;
+
+static uint64_t *dirty[MEMVIEW_USERS];  /* un bit por pagina */
+static uint64_t base = 0, size = 0, pages = 0;
+
+#define WORDS ((pages + 63) / 64)
+
+void memview_init(uint64_t ram_base, uint64_t ram_size)
+{
+  base = ram_base;
+  size = ram_size;
+  pages = (ram_size + (1 << MEMVIEW_PAGE_SHIFT) - 1) >> MEMVIEW_PAGE_SHIFT;
+
+  for (int u = 0; u < MEMVIEW_USERS; u++) {
+    free(dirty[u]);
+    dirty[u] = calloc(WORDS, sizeof(uint64_t));
+    if (dirty[u] == NULL) {
+      fprintf(stderr, "Cannot allocate dirty page bitmap\n");
+      exit(1);
+    }
+  }
+  /* El ELF ya esta cargado: todas las paginas estan por leer */
+  for (uint64_t i = 0; i < WORDS; i++)
+    dirty[MEMVIEW_IDE][i] = ~UINT64_C(0);
+}
+
+void memview_reset(void)
+{
+  for (int u = 0; u < MEMVIEW_USERS; u++) {
+    free(dirty[u]);
+    dirty[u] = NULL;
+  }
+  size = pages = 0;
+  memview_attached = false;
+}
+
+void memview_write(uint64_t paddr, uint64_t width)
+{
+  if (paddr < base || paddr - base >= size || width == 0)
+    return;
+
+  uint64_t first = (paddr - base) >> MEMVIEW_PAGE_SHIFT;
+  uint64_t last = (paddr - base + width - 1) >> MEMVIEW_PAGE_SHIFT;
+  if (last >= pages)
+    last = pages - 1;
+  for (uint64_t p = first; p <= last; p++)
+    for (int u = 0; u < MEMVIEW_USERS; u++)
+      dirty[u][p / 64] |= UINT64_C(1) << (p % 64);
+}
+
+uint64_t memview_pages(void)
+{
+  return pages;
+}
+
+uint64_t memview_page_addr(uint64_t page)
+{
+  return base + (page << MEMVIEW_PAGE_SHIFT);
+}
+
+bool memview_dirty(enum memview_user user, uint64_t page)
+{
+  return (dirty[user][page / 64] >> (page % 64)) & 1;
+}
+
+void memview_clear(enum memview_user user)
+{
+  for (uint64_t i = 0; i < WORDS; i++)
+    dirty[user][i] = 0;
+}
+
+EMSCRIPTEN_KEEPALIVE uint32_t get_dirty_pages(uint64_t *out, uint32_t max)
+{
+  uint32_t n = 0;
+
+  memview_attached = true;
+  uint64_t *ide = dirty[MEMVIEW_IDE];
+  for (uint64_t w = 0; w < WORDS && n < max; w++) {
+    while (ide[w] && n < max) {
+      uint64_t bit = __builtin_ctzll(ide[w]);
+      uint64_t p = w * 64 + bit;
+      ide[w] &= ide[w] - 1;
+      if (p < pages)
+        out[n++] = base + (p << MEMVIEW_PAGE_SHIFT);
+    }
+  }
+  return n;
+}
+
+EMSCRIPTEN_KEEPALIVE uint32_t read_guest(uint64_t addr, uint32_t len, uint8_t *out)
+{
+  if (addr < base || addr - base >= size)
+    return 0;
+  if (len > size - (addr - base))
+    len = size - (addr - base);
+
+  for (uint32_t i = 0; i < len; i++)
+    out[i] = (uint8_t)read_mem(addr + i);
+  return len;
+}
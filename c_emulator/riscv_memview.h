@@ -0,0 +1,46 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Guest memory viewer for the IDE.
+
+   RAM is tracked in 4 KiB pages with a bitmap: every store of the model
+   (mem_ref() from phys_mem_write and copy_to_guest()) sets the bit
+   of the pages it touches. After loading, all pages start dirty.
+
+   get_dirty_pages(out, max) writes the guest address of up to max dirty
+   pages to out (a BigUint64Array on the host), clears their bits and
+   returns how many were written; pages that did not fit stay dirty for
+   the next call. read_guest(addr, len, out) copies len bytes of RAM from
+   addr to out and returns the bytes copied (it stops at the end of RAM).
+   RAM lives in the sparse memory of the Sail runtime, so the panel reads
+   copies of the changed pages instead of a view of the backing store.
+
+   Once the host has called get_dirty_pages(), the model no longer prints
+   a "mem[...]" line per access.
+
+   The checkpoints (riscv_ckpt.h) keep their own bitmaps of the same
+   stores: pages written since the last checkpoint and since loading.
+   Those start clean, the ELF is loaded again before a restore. */
+
+#define MEMVIEW_PAGE_SHIFT 12
+#define MEMVIEW_PAGE_SIZE (UINT64_C(1) << MEMVIEW_PAGE_SHIFT)
+
+enum memview_user {
+  MEMVIEW_IDE,       /* get_dirty_pages() */
+  MEMVIEW_CKPT,      /* desde el ultimo checkpoint */
+  MEMVIEW_CKPT_LOAD, /* desde la carga del ELF */
+  MEMVIEW_USERS
+};
+
+extern bool memview_attached;
+
+void memview_init(uint64_t ram_base, uint64_t ram_size);
+void memview_reset(void);
+void memview_write(uint64_t paddr, uint64_t width);
+
+/* Bitmaps of the checkpoints: pages are numbered from 0 at ram_base */
+uint64_t memview_pages(void);
+uint64_t memview_page_addr(uint64_t page);
+bool memview_dirty(enum memview_user user, uint64_t page);
+void memview_clear(enum memview_user user);
@@ -3,6 +3,11 @@
 #include "riscv_prelude.h"
 #include "riscv_platform_impl.h"
 #include "riscv_sail.h"
+#include "riscv_console.h"
+#include "riscv_sweep.h"
+#include "riscv_trace.h"
+#include "riscv_memview.h"
+#include "riscv_smp.h"
 #ifndef LOCALSIM
   #include <emscripten.h>
 #endif
@@ -19,8 +24,9 @@
 
 /* This file contains the definitions of the C externs of Sail model. */
 
-static mach_bits reservation = 0;
-static bool reservation_valid = false;
+/* Una reserva LR/SC por hart (--harts) */
+static mach_bits reservation[SMP_MAX_HARTS];
+static bool reservation_valid[SMP_MAX_HARTS];
 
 typedef struct {
   uint32_t low_double;
@@ -37,6 +43,17 @@ char c_keyboard;
 char *s_keyboard;
 bool force_exit = false;
 
+/* State of the previous run, cleared when the IDE reuses the module */
+void platform_reset(void)
+{
+  memset(reservation, 0, sizeof(reservation));
+  memset(reservation_valid, 0, sizeof(reservation_valid));
+  debug_mode = true;
+  should_pause = -1;
+  first_it = true;
+  force_exit = false;
+}
+
 bool sys_enable_rvc(unit u)
 {
   return rv_enable_rvc;
@@ -113,6 +130,12 @@ bool plat_mtval_has_illegal_inst_bits(unit u)
   return rv_mtval_has_illegal_inst_bits;
 }
 
+/* Con varias harts las demas siguen ejecutando: el tiempo no se salta */
+bool plat_wfi_skip(unit u)
+{
+  return rv_enable_wfi_skip && smp_harts <= 1;
+}
+
 mach_bits plat_ram_base(unit u)
 {
   return rv_ram_base;
@@ -151,9 +174,9 @@ mach_bits plat_clint_size(unit u)
 
 unit load_reservation(mach_bits addr)
 {
-  reservation = addr;
-  reservation_valid = true;
-  RESERVATION_DBG("reservation <- %0" PRIx64 "\n", reservation);
+  reservation[smp_hart] = addr;
+  reservation_valid[smp_hart] = true;
+  RESERVATION_DBG("reservation <- %0" PRIx64 "\n", addr);
   return UNIT;
 }
 
@@ -170,17 +193,82 @@ static mach_bits check_mask(void)
 bool match_reservation(mach_bits addr)
 {
   mach_bits mask = check_mask();
-  bool ret = reservation_valid && (reservation & mask) == (addr & mask);
+  bool ret = reservation_valid[smp_hart]
+      && (reservation[smp_hart] & mask) == (addr & mask);
   RESERVATION_DBG("reservation(%c): %0" PRIx64 ", key=%0" PRIx64 ": %s\n",
-                  reservation_valid ? 'v' : 'i', reservation, addr,
-                  ret ? "ok" : "fail");
+                  reservation_valid[smp_hart] ? 'v' : 'i',
+                  reservation[smp_hart], addr, ret ? "ok" : "fail");
   return ret;
 }
 
 unit cancel_reservation(unit u)
 {
   RESERVATION_DBG("reservation <- none\n");
-  reservation_valid = false;
+  reservation_valid[smp_hart] = false;
+  return UNIT;
+}
+
+/* Un store de una hart cancela la reserva de las demas en su granulo */
+static void reservation_store(mach_bits paddr, uint64_t width)
+{
+  for (unsigned h = 0; h < smp_harts; h++) {
+    mach_bits granule = reservation[h] & ~(mach_bits)7;
+    if (h != smp_hart && reservation_valid[h]
+        && paddr < granule + 8 && granule < paddr + width)
+      reservation_valid[h] = false;
+  }
+}
+
+/* PMP decision cache: direct-mapped, one entry per (page, privilege, access
+   type). Entries are tagged with a generation number, so flushing it on a
+   pmpcfg/pmpaddr/mstatus.MPRV write is a single increment. */
+#define PMP_CACHE_ENTRIES 256
+
+struct pmp_cache_entry {
+  uint64_t page;
+  uint32_t gen;
+  uint8_t key;
+  uint8_t decision;
+};
+
+static struct pmp_cache_entry pmp_cache[PMP_CACHE_ENTRIES];
+static uint32_t pmp_cache_gen = 1;
+
+static inline struct pmp_cache_entry *pmp_cache_slot(uint64_t page, uint8_t key)
+{
+  return &pmp_cache[(page ^ ((uint64_t)key << 4)) & (PMP_CACHE_ENTRIES - 1)];
+}
+
+mach_bits pmp_cache_lookup(mach_bits addr, mach_bits priv, mach_bits acc)
+{
+  uint64_t page = addr >> 12;
+  uint8_t key = (priv << 2) | acc;
+  struct pmp_cache_entry *e = pmp_cache_slot(page, key);
+
+  if (e->gen == pmp_cache_gen && e->page == page && e->key == key)
+    return e->decision;
+  return 0;
+}
+
+unit pmp_cache_insert(mach_bits addr, mach_bits priv, mach_bits acc, mach_bits decision)
+{
+  uint64_t page = addr >> 12;
+  uint8_t key = (priv << 2) | acc;
+  struct pmp_cache_entry *e = pmp_cache_slot(page, key);
+
+  e->page = page;
+  e->key = key;
+  e->decision = decision;
+  e->gen = pmp_cache_gen;
+  return UNIT;
+}
+
+unit pmp_cache_flush(unit u)
+{
+  if (++pmp_cache_gen == 0) {
+    memset(pmp_cache, 0, sizeof(pmp_cache));
+    pmp_cache_gen = 1;
+  }
   return UNIT;
 }
 
@@ -208,33 +296,131 @@ unit print_test_C(mach_bits argument, bool rt){
   if(rt == true){
     double result;
     memcpy(&result, &argument, sizeof(double));
-    printf("ECALL DOUBLE: %lf\n", result);
+    console_printf("ECALL DOUBLE: %lf\n", result);
   }
   else 
-    printf("ECALL FLOAT: %f\n", *(float*)&argument);
+    console_printf("ECALL FLOAT: %f\n", *(float*)&argument);
     return UNIT;
 }
 
 
-unit print_string_C(char* message){
-  printf("ECALL STRING: %s\n", message);
+/* Todas las lecturas y escrituras de memoria fisica del modelo */
+unit mem_ref(uint8_t kind, mach_bits paddr, uint16_t width){
+  if (sweep_enabled)
+    sweep_access(kind, paddr, width);
+  if (trace_enabled)
+    trace_mem(kind, zPC, paddr, width);
+  if (kind == 2) {
+    memview_write(paddr, width);
+    if (smp_harts > 1)
+      reservation_store(paddr, width);
+  }
+  return UNIT;
+}
+
+/* Prints the NUL-terminated guest string at addr (ecall 4). The string is
+   copied out of guest memory in chunks and scanned with memchr, instead of
+   building it one byte at a time on the Sail side. The scan stops at the
+   NUL, at max_len bytes or at the end of RAM, whichever comes first. */
+#define GUEST_CSTRING_CHUNK 256
+
+unit print_guest_cstring(mach_bits addr, mach_bits max_len){
+  uint8_t chunk[GUEST_CSTRING_CHUNK];
+  uint64_t ram_end = rv_ram_base + rv_ram_size;
+  bool started = false;
+
+  if (addr >= rv_ram_base && addr < ram_end && max_len > ram_end - addr)
+    max_len = ram_end - addr;
+
+  while (max_len > 0) {
+    size_t n = max_len < GUEST_CSTRING_CHUNK ? max_len : GUEST_CSTRING_CHUNK;
+    for (size_t i = 0; i < n; i++)
+      chunk[i] = (uint8_t)read_mem(addr + i);
+
+    uint8_t *nul = memchr(chunk, 0, n);
+    size_t len = nul ? (size_t)(nul - chunk) : n;
+    if (len > 0) {
+      if (!started)
+        console_write("ECALL STRING: ", 14);
+      started = true;
+      console_write((const char *)chunk, len);
+    }
+    if (nul)
+      break;
+    addr += n;
+    max_len -= n;
+  }
+
+  if (started)
+    console_write("\n", 1);
   return UNIT;
 }
 
-uint8_t read_s(uint32_t index){
-  return (uint8_t)s_keyboard[index];
+/* Copies len bytes from buf into guest RAM at addr, as the stores of a
+   memcpy would: the whole range is checked once against RAM and the PMP of
+   the running hart, then it is written in naturally aligned chunks of up
+   to XLEN bits, each one seen by mem_ref() (reservations of other harts,
+   --mem-trace, cache sweep, memview) and by the mem[...] trace of the IDE
+   like a store of the model. Returns the number of bytes copied, 0 if the
+   range does not fit in RAM or GUEST_COPY_DENIED if the PMP denies it. */
+uint64_t copy_to_guest(uint64_t addr, const uint8_t *buf, uint64_t len){
+  uint64_t ram_end = rv_ram_base + rv_ram_size;
+  uint64_t max_width = zxlen_val / 8;
+  bool notify = get_config_print_mem(UNIT);
+  char line[96];
+
+  if (addr < rv_ram_base || addr >= ram_end || len > ram_end - addr)
+    return 0;
+  if (!zguest_write_allowed(addr, len))
+    return GUEST_COPY_DENIED;
+
+  for (uint64_t done = 0; done < len;) {
+    uint64_t width = max_width;
+    while (width > 1 && ((addr + done) % width != 0 || width > len - done))
+      width /= 2;
+
+    uint64_t data = 0;
+    for (uint64_t i = 0; i < width; i++) {
+      write_mem(addr + done + i, buf[done + i]);
+      data |= (uint64_t)buf[done + i] << (8 * i);
+    }
+    mem_ref(2, addr + done, width);
+    if (notify) {
+      /* mismo formato que phys_mem_write(): BitStr de la direccion y el dato */
+      snprintf(line, sizeof(line), "mem[0x%0*" PRIX64 "] <- 0x%0*" PRIX64,
+               (int)(zxlen_val / 4), addr + done, (int)(2 * width), data);
+#ifdef RV32
+      print_reg(line);
+#else
+      print_mem_access(line);
+#endif
+    }
+    done += width;
+  }
+  return len;
+}
+
+/* Stores the last string entered by the user (ecall 8) at addr, NUL
+   included, writing at most max_len bytes. */
+mach_bits copy_input_to_guest(mach_bits addr, mach_bits max_len){
+  if (s_keyboard == NULL || max_len == 0)
+    return 0;
+
+  uint64_t len = strlen(s_keyboard) + 1;
+  if (len > max_len)
+    len = max_len;
+  uint64_t copied = copy_to_guest(addr, (const uint8_t *)s_keyboard, len);
+  return copied == GUEST_COPY_DENIED ? check_mask() : copied; /* ones() en Sail */
 }
 
 unit send_error_c(unit c){
-    printf("err call_convenction\n");
+    model_printf("err call_convenction\n");
   return UNIT; 
 }
 
+/* Victima de la politica de reemplazo aleatoria de la cache */
 uint32_t rand_num(uint16_t a){
-  
-  uint32_t result = rand() % a;
-  printf("Resultado: %d\n", result);
-  return result;
+  return a ? rv_random() % a : 0;
 }
 
 uint32_t crep(unit c) {
@@ -243,7 +429,7 @@ uint32_t crep(unit c) {
 
 uint32_t which_cache_levels(unit c) {
   uint32_t result = emscripten_run_script_int("document.app.$data.cache_type");
-  printf("Type cache: %d\n", result);
+  model_printf("Type cache: %d\n", result);
   return result;
 }
 
@@ -253,27 +439,27 @@ uint32_t cache_sizes(uint8_t val){
   switch(val){
     case 1:
       result = emscripten_run_script_int("document.app.$data.L1_size");
-      printf("L1 size: %d\n", result);
+      model_printf("L1 size: %d\n", result);
     break;
     case 2:
       result = emscripten_run_script_int("document.app.$data.L1_I_size");
-      printf("L1_I size: %d\n", result);
+      model_printf("L1_I size: %d\n", result);
     break;
     case 3:
       result = emscripten_run_script_int("document.app.$data.L1_D_size");
-      printf("L1_D size: %d\n", result);
+      model_printf("L1_D size: %d\n", result);
     break;
     case 4:
       result = emscripten_run_script_int("document.app.$data.L2_size");
-      printf("L2 size: %d\n", result);
+      model_printf("L2 size: %d\n", result);
     break;
     case 5:
       result = emscripten_run_script_int("document.app.$data.L2_I_size");
-      printf("L2_I size: %d\n", result);
+      model_printf("L2_I size: %d\n", result);
     break;
     case 6:
       result = emscripten_run_script_int("document.app.$data.L2_D_size");
-      printf("L2_D size: %d\n", result);
+      model_printf("L2_D size: %d\n", result);
     break;
   }
   return result;
@@ -350,7 +536,7 @@ uint32_t set_config(uint8_t val) {
               auxr >>= 1;
             }
             result = 32 - aux - index;
-            printf("bits para tag:%d\n", result);
+            model_printf("bits para tag:%d\n", result);
           } else if (a == 1) {
             uint32_t auxr = (emscripten_run_script_int("document.app.$data.L1_size") / emscripten_run_script_int("document.app.$data.L1_num_lines")) - 1;
             while (auxr > 0) {
@@ -358,13 +544,13 @@ uint32_t set_config(uint8_t val) {
               auxr >>= 1;
             }
             
-            printf("bits para index:%d\n", result);
+            model_printf("bits para index:%d\n", result);
           } else if (a == 2) {
             result = emscripten_run_script_int("document.app.$data.L1_size_block");
             if (result == 32) result = 2;
             else if (result == 64) result = 3;
             else if (result == 128) result = 4;
-            printf("bits para offset:%d\n", result);
+            model_printf("bits para offset:%d\n", result);
           }
 
         break;
@@ -542,7 +728,7 @@ uint32_t set_config(uint8_t val) {
               auxr >>= 1;
             }
             result = 32 - aux - index;
-            printf("bits para tag:%d\n", result);
+            model_printf("bits para tag:%d\n", result);
           } else if (a == 1) {
             uint32_t auxr = ( emscripten_run_script_int("document.app.$data.L1_num_lines")) - 1;
             while (auxr > 0) {
@@ -550,13 +736,13 @@ uint32_t set_config(uint8_t val) {
               auxr >>= 1;
             }
             
-            printf("bits para index:%d\n", result);
+            model_printf("bits para index:%d\n", result);
           } else if (a == 2) {
             result = emscripten_run_script_int("document.app.$data.L1_size_block");
             if (result == 32) result = 2;
             else if (result == 64) result = 3;
             else if (result == 128) result = 4;
-            printf("bits para offset:%d\n", result);
+            model_printf("bits para offset:%d\n", result);
           }
 
         break;
@@ -744,7 +930,7 @@ uint32_t set_config(uint8_t val) {
               auxr >>= 1;
             }
             result = 64 - aux - index;
-            printf("bits para tag:%d\n", result);
+            model_printf("bits para tag:%d\n", result);
           } else if (a == 1) {
             uint32_t auxr = (emscripten_run_script_int("document.app.$data.L1_size") / emscripten_run_script_int("document.app.$data.L1_num_lines")) - 1;
             while (auxr > 0) {
@@ -752,13 +938,13 @@ uint32_t set_config(uint8_t val) {
               auxr >>= 1;
             }
             
-            printf("bits para index:%d\n", result);
+            model_printf("bits para index:%d\n", result);
           } else if (a == 2) {
             result = emscripten_run_script_int("document.app.$data.L1_size_block");
             if (result == 32) result = 2;
             else if (result == 64) result = 3;
             else if (result == 128) result = 4;
-            printf("bits para offset:%d\n", result);
+            model_printf("bits para offset:%d\n", result);
           }
 
         break;
@@ -936,7 +1122,7 @@ uint32_t set_config(uint8_t val) {
               auxr >>= 1;
             }
             result = 64 - aux - index;
-            printf("bits para tag:%d\n", result);
+            model_printf("bits para tag:%d\n", result);
           } else if (a == 1) {
             uint32_t auxr = (emscripten_run_script_int("document.app.$data.L1_num_lines")) - 1;
             while (auxr > 0) {
@@ -944,13 +1130,13 @@ uint32_t set_config(uint8_t val) {
               auxr >>= 1;
             }
             
-            printf("bits para index:%d\n", result);
+            model_printf("bits para index:%d\n", result);
           } else if (a == 2) {
             result = emscripten_run_script_int("document.app.$data.L1_size_block");
             if (result == 32) result = 2;
             else if (result == 64) result = 3;
             else if (result == 128) result = 4;
-            printf("bits para offset:%d\n", result);
+            model_printf("bits para offset:%d\n", result);
           }
 
         break;
@@ -1153,23 +1339,24 @@ uint32_t set_config(uint8_t val) {
 
   EMSCRIPTEN_KEEPALIVE void send_string_to_C (char* value) {
     
-    printf("String recibido: %s\n", value);
+    model_printf("String recibido: %s\n", value);
     if (s_keyboard)
       free(s_keyboard);
 
     s_keyboard = (char *)malloc(strlen(value) +1);
     if (s_keyboard == NULL) {
-          printf("Error al asignar memoria\n");
+          model_printf("Error al asignar memoria\n");
           return;
       }
     strcpy(s_keyboard, value);
     should_pause = 2;
     
-    printf("String almacenado: %s\n", value);
+    model_printf("String almacenado: %s\n", value);
   }
 
 
   uint32_t read_int_C(unit c){
+    console_flush();
     
     while(should_pause != 2){ // Se realiza una espera activa hasta que el usuario haya introducido el valor correspondiente
       emscripten_sleep(100);
@@ -1182,10 +1369,11 @@ uint32_t set_config(uint8_t val) {
   }
 
   uint32_t read_float_C(unit c){
+    console_flush();
     while (should_pause != 2)
     {
       emscripten_sleep(100); // Espera activa hasta que se actualice la variable
-      printf("Esperando un float\n");
+      model_printf("Esperando un float\n");
     }
     uint64_t result;
     memcpy(&result, &f_keyboard, sizeof(float));
@@ -1195,6 +1383,7 @@ uint32_t set_config(uint8_t val) {
   }
 
   uint32_t read_double_32C_low(unit c){
+    console_flush();
     while (should_pause != 2)
     {
       emscripten_sleep(100); // Espera activa hasta que el usuario pase el parámetro
@@ -1216,23 +1405,25 @@ uint32_t set_config(uint8_t val) {
   }
 
   uint64_t read_double_64C(unit c){
+    console_flush();
     while (should_pause != 2)
     {
       emscripten_sleep(100); // Espera activa hasta que el usuario pase el parámetro
-      printf("Esperando un double\n");
+      model_printf("Esperando un double\n");
     }
     
     uint64_t result;
     memcpy(&result, &d_keyboard, sizeof(double));
     should_pause = -1;
-    printf("Double a enviar: %llx\n", result);
+    model_printf("Double a enviar: %llx\n", result);
     return result;
   }
 
   uint8_t read_char_C(unit c){
+    console_flush();
     while(should_pause != 2){
       emscripten_sleep(100);
-      printf("Esperando un char\n");
+      model_printf("Esperando un char\n");
     }
     uint32_t result;
     memcpy(&result, &c_keyboard, sizeof(char));
@@ -1241,6 +1432,7 @@ uint32_t set_config(uint8_t val) {
   }
 
   uint8_t read_string_C(uint8_t size_string){
+    console_flush();
     while (should_pause != 2)
     {
       emscripten_sleep(100);
@@ -1268,10 +1460,10 @@ uint32_t set_config(uint8_t val) {
   uint32_t get_entry(int a) {
     uint32_t default_entry = (zxlen_val == 32) ? 0x80000000u : 0x00000000u;
     // if (is_32bit_model())
-    printf("Default entry: %08X \n", default_entry);
+    model_printf("Default entry: %08X \n", default_entry);
     // default instruction 00028293 es lo mismo que t0 = t0 + 0, los 12 bits mas significativos son el imm 
     uint32_t aux = emscripten_run_script_int("document.app.$data.entry_elf");
-    printf("Entrada del programa %08X \n", aux);
+    model_printf("Entrada del programa %08X \n", aux);
     
     if(zxlen_val == 32){
       
@@ -1332,6 +1524,7 @@ uint32_t set_config(uint8_t val) {
       
       // Verificar si se debe pausar
       if (debug_mode && (should_pause == -1 || should_pause == 1)) {
+        console_flush();
         while((should_pause == -1 && debug_mode)){
           if (force_exit){
             exit(1);
@@ -1341,6 +1534,7 @@ uint32_t set_config(uint8_t val) {
         }
         debug_mode = should_pause;
       } else if (debug_mode == 0 && is_next_breakpoint){
+        console_flush();
         while((should_pause == -1 && debug_mode == 0)){
           if (force_exit){
             exit(1);
@@ -1357,12 +1551,13 @@ uint32_t set_config(uint8_t val) {
       bool isbreakpoint = emscripten_run_script_int("document.app.$data.is_breakpoint");
       debug_mode = emscripten_run_script_int("document.app.$data.execution_mode_run");
       if (isbreakpoint && debug_mode == 0){
+        console_flush();
         while(should_pause == -1){
           if (force_exit){
             exit(1);
-            printf("Antes del reset\n");
+            model_printf("Antes del reset\n");
             emscripten_run_script("resetenvironment(1)");
-            printf("Post reset\n");
+            model_printf("Post reset\n");
           }
           emscripten_sleep(100);
         }
@@ -1377,12 +1572,12 @@ uint32_t set_config(uint8_t val) {
   unit printdou(uint64_t value){
     double result;
     memcpy(&result, &value, sizeof(double));
-    printf("Hexa doble: %016llX \n", value);
-    printf("Double 32bits: %f\n", result);
+    model_printf("Hexa doble: %016llX \n", value);
+    model_printf("Double 32bits: %f\n", result);
     return 0;
   }
   unit print_fpreg(uint8_t id, uint32_t h_value, uint32_t l_value){
-    printf("f%d <- 0x%08X%08X \n", id, h_value,l_value);
+    model_printf("f%d <- 0x%08X%08X \n", id, h_value,l_value);
     return 0;
   }
 
@@ -1395,11 +1590,11 @@ uint32_t set_config(uint8_t val) {
                               uint32_t g1, uint32_t g2,
                               uint32_t h1, uint32_t h2){
     
-    printf("v%d <- 0x%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X\n", id, a1, a2, b1, b2, c1, c2, d1, d2, e1, e2, f1, f2, g1, g2, h1, h2);
+    model_printf("v%d <- 0x%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X\n", id, a1, a2, b1, b2, c1, c2, d1, d2, e1, e2, f1, f2, g1, g2, h1, h2);
     return 0;
   };
   unit print_memory(uint32_t addr, uint32_t valueh, uint32_t valuel){
-    printf("mem[0x%08X] <- 0x%08X%08X \n", addr, valueh, valuel);
+    model_printf("mem[0x%08X] <- 0x%08X%08X \n", addr, valueh, valuel);
     return 0;
   }
 
@@ -1410,12 +1605,14 @@ uint32_t set_config(uint8_t val) {
   }
 
   uint32_t read_int_C(){
+    console_flush();
     int a;
     scanf("%d", &a);
     return (uint32_t)a;
   }
 
   uint32_t read_float_C(){
+    console_flush();
     float a;
     scanf("%f", &a);
     uint32_t result;
@@ -1424,6 +1621,7 @@ uint32_t set_config(uint8_t val) {
   }
 
   uint32_t read_double_32C_low(){
+    console_flush();
     float a;
     scanf("%f", &a);
     uint32_t result;
@@ -1440,6 +1638,7 @@ uint32_t set_config(uint8_t val) {
   }
 
   uint64_t read_double_64C(){
+    console_flush();
     double a;
     scanf("%lf", &a);
     uint64_t result;
@@ -1448,6 +1647,7 @@ uint32_t set_config(uint8_t val) {
   }
 
   uint8_t read_char_C(){
+    console_flush();
     char a;
     scanf(" %c", &a);
     uint32_t result;
@@ -1456,6 +1656,7 @@ uint32_t set_config(uint8_t val) {
   }
 
   uint8_t read_string_C(uint8_t size_string){
+    console_flush();
     char a[size_string];
     scanf("%s", a);
     s_keyboard = (char *)malloc(size_string + 1);
@@ -1477,13 +1678,13 @@ uint32_t set_config(uint8_t val) {
 
     uint32_t default_entry = (zxlen_val == 32) ? 0x80000000u : 0x00000000u;
     // if (is_32bit_model())
-    printf("Default entry: %08X \n", default_entry);
+    model_printf("Default entry: %08X \n", default_entry);
     // default instruction 00028293 es lo mismo que t0 = t0 + 0, los 12 bits mas significativos son el imm 
     uint32_t aux = default_entry;
     if (creator_entry != aux)
       aux = creator_entry;
 
-    printf("Entrada del programa %08X \n", aux);
+    model_printf("Entrada del programa %08X \n", aux);
     
     if(zxlen_val == 32){
       
@@ -1538,6 +1739,7 @@ uint32_t set_config(uint8_t val) {
     if (!debug_mode)
       return false;
     else {
+      console_flush();
       uint32_t debug;
       scanf("%d", &debug);
       debug_mode = (debug != 0);
@@ -1548,12 +1750,12 @@ uint32_t set_config(uint8_t val) {
   unit printdou(uint64_t value){
     double result;
     memcpy(&result, &value, sizeof(double));
-    printf("Hexa doble: %016lX \n", value);
-    printf("Double 32bits: %f\n", result);
+    model_printf("Hexa doble: %016lX \n", value);
+    model_printf("Double 32bits: %f\n", result);
     return 0;
   }
   unit print_fpreg(uint8_t id, uint32_t h_value, uint32_t l_value){
-    printf("f%d <- 0x%08X%08X \n", id, h_value,l_value);
+    model_printf("f%d <- 0x%08X%08X \n", id, h_value,l_value);
     return 0;
   }
 
@@ -1566,11 +1768,11 @@ uint32_t set_config(uint8_t val) {
                               uint32_t g1, uint32_t g2,
                               uint32_t h1, uint32_t h2){
     
-    printf("v%d <- 0x%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X\n", id, a1, a2, b1, b2, c1, c2, d1, d2, e1, e2, f1, f2, g1, g2, h1, h2);
+    model_printf("v%d <- 0x%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X\n", id, a1, a2, b1, b2, c1, c2, d1, d2, e1, e2, f1, f2, g1, g2, h1, h2);
     return 0;
   };
   unit print_memory(uint32_t addr, uint32_t valueh, uint32_t valuel){
-    printf("mem[0x%08X] <- 0x%08X%08X \n", addr, valueh, valuel);
+    model_printf("mem[0x%08X] <- 0x%08X%08X \n", addr, valueh, valuel);
     return 0;
   }
 #endif
\ No newline at end of file
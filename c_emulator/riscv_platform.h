@@ -1,5 +1,9 @@
 #pragma once
 #include "sail.h"
+#include "riscv_console.h"
+#include "riscv_stats.h"
+#include "riscv_bpred.h"
+#include "riscv_regview.h"
 
 bool sys_enable_rvc(unit);
 bool sys_enable_next(unit);
@@ -18,6 +22,7 @@ uint64_t sys_pmp_grain(unit);
 bool plat_enable_dirty_update(unit);
 bool plat_enable_misaligned_access(unit);
 bool plat_mtval_has_illegal_inst_bits(unit);
+bool plat_wfi_skip(unit);
 
 mach_bits plat_ram_base(unit);
 mach_bits plat_ram_size(unit);
@@ -37,6 +42,10 @@ unit load_reservation(mach_bits);
 bool match_reservation(mach_bits);
 unit cancel_reservation(unit);
 
+mach_bits pmp_cache_lookup(mach_bits, mach_bits, mach_bits);
+unit pmp_cache_insert(mach_bits, mach_bits, mach_bits, mach_bits);
+unit pmp_cache_flush(unit);
+
 void plat_insns_per_tick(sail_int *rop, unit);
 
 unit plat_term_write(mach_bits);
@@ -44,9 +53,13 @@ mach_bits plat_htif_tohost(unit);
 
 unit memea(mach_bits, sail_int);
 unit print_test_C(mach_bits argument, bool rt);
-unit print_string_C(char* message);
+unit print_guest_cstring(mach_bits addr, mach_bits max_len);
 unit send_error_c(unit);
-uint8_t read_s(uint32_t);
+uint64_t copy_to_guest(uint64_t addr, const uint8_t *buf, uint64_t len);
+mach_bits copy_input_to_guest(mach_bits addr, mach_bits max_len);
+void platform_reset(void);
+extern bool debug_mode; /* paso a paso: LOCALSIM lo lee de stdin en cada paso */
+unit mem_ref(uint8_t kind, mach_bits paddr, uint16_t width);
 uint32_t rand_num(uint16_t);
 uint32_t crep(unit);
 uint32_t which_cache_levels(unit);
@@ -23,6 +23,7 @@ uint32_t creator_entry = 0;
 bool rv_enable_dirty_update = false;
 bool rv_enable_misaligned = false;
 bool rv_mtval_has_illegal_inst_bits = false;
+bool rv_enable_wfi_skip = true;
 bool rv_enable_writable_fiom = true;
 
 /*PAra la version de 32bits*/
@@ -46,19 +47,49 @@ bool rv_enable_writable_fiom = true;
 
 #endif
 
+/* xoshiro256** del simulador, sembrado con splitmix64 */
+static uint64_t rng_state[4];
+
+void rv_random_init(uint64_t seed)
+{
+  for (int i = 0; i < 4; i++) {
+    uint64_t z = (seed += UINT64_C(0x9e3779b97f4a7c15));
+    z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+    z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+    rng_state[i] = z ^ (z >> 31);
+  }
+}
+
+/* Para los checkpoints */
+uint64_t *rv_random_state(void)
+{
+  return rng_state;
+}
+
+static inline uint64_t rotl(uint64_t x, int k)
+{
+  return (x << k) | (x >> (64 - k));
+}
+
+uint64_t rv_random(void)
+{
+  uint64_t *s = rng_state;
+  uint64_t result = rotl(s[1] * 5, 7) * 9;
+  uint64_t t = s[1] << 17;
+
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rotl(s[3], 45);
+  return result;
+}
+
 // Provides entropy for the scalar cryptography extension.
 uint64_t rv_16_random_bits(void)
 {
-  // This function can be changed to support deterministic sequences of
-  // pseudo-random bytes. This is useful for testing.
-  const char *name = "/dev/urandom";
-  FILE *f = fopen(name, "rb");
-  uint16_t val;
-  if (fread(&val, 2, 1, f) != 1) {
-    fprintf(stderr, "Unable to read 2 bytes from %s\n", name);
-  }
-  fclose(f);
-  return (uint64_t)val;
+  return rv_random() >> 48;
 }
 
 uint64_t rv_clint_base = UINT64_C(0x2000000);
@@ -34,6 +34,7 @@ extern bool rv_enable_writable_misa;
 extern bool rv_enable_dirty_update;
 extern bool rv_enable_misaligned;
 extern bool rv_mtval_has_illegal_inst_bits;
+extern bool rv_enable_wfi_skip;
 extern bool rv_enable_writable_fiom;
 extern uint32_t check_cache;
 extern uint32_t crep_value;
@@ -45,9 +46,20 @@ extern uint8_t sudo;
 extern uint64_t rv_ram_base;
 extern uint64_t rv_ram_size;
 
+/* Return value of copy_to_guest() (riscv_platform.c) when the PMP denies
+   the store */
+#define GUEST_COPY_DENIED UINT64_MAX
+
 extern uint64_t rv_rom_base;
 extern uint64_t rv_rom_size;
 
+/* Random numbers of the simulator (Zkr seed, random cache replacement).
+   The same seed (--seed) gives the same sequence, so runs can be
+   reproduced. */
+void rv_random_init(uint64_t seed);
+uint64_t rv_random(void);
+uint64_t *rv_random_state(void); /* 4 words, saved by the checkpoints */
+
 // Provides entropy for the scalar cryptography extension.
 extern uint64_t rv_16_random_bits(void);
 
@@ -1,39 +1,48 @@
 #include "riscv_prelude.h"
 #include "riscv_config.h"
 #include "riscv_platform_impl.h"
+#include "riscv_memview.h"
+
+/* Las trazas comparten stdout con la consola: primero su texto pendiente */
+static FILE *trace_out(void)
+{
+  if (trace_log == stdout)
+    console_flush();
+  return trace_log;
+}
 
 unit print_string(sail_string prefix, sail_string msg)
 {
-  printf("%s%s\n", prefix, msg);
+  model_printf("%s%s\n", prefix, msg);
   return UNIT;
 }
 
 unit print_instr(sail_string s)
 {
   if (config_print_instr)
-    fprintf(trace_log, "%s\n", s);
+    fprintf(trace_out(), "%s\n", s);
   return UNIT;
 }
 
 unit print_reg(sail_string s)
 {
   if (config_print_reg)
-    fprintf(trace_log, "%s\n", s);
+    fprintf(trace_out(), "%s\n", s);
   return UNIT;
 }
 
 unit print_mem_access(sail_string s)
 {
-    fprintf(trace_log, "%s\n", s);
+    fprintf(trace_out(), "%s\n", s);
   if (config_print_mem_access)
-    fprintf(trace_log, "%s\n", s);
+    fprintf(trace_out(), "%s\n", s);
   return UNIT;
 }
 
 unit print_platform(sail_string s)
 {
   if (config_print_platform)
-    fprintf(trace_log, "%s\n", s);
+    fprintf(trace_out(), "%s\n", s);
   return UNIT;
 }
 
@@ -49,7 +58,8 @@ bool get_config_print_reg(unit u)
 
 bool get_config_print_mem(unit u)
 {
-  return (config_print_mem_access) ? true : false;
+  /* El IDE lee las paginas modificadas con get_dirty_pages() */
+  return (config_print_mem_access && !memview_attached) ? true : false;
 }
 
 bool get_config_print_platform(unit u)
@@ -2,6 +2,14 @@
 #include "sail.h"
 #include "rts.h"
 #include "riscv_softfloat.h"
+#include "riscv_console.h"
+
+/* The prints of the Sail runtime (print_endline, print_int, print_bits) go
+   straight to stdout: the generated model calls them through these macros,
+   which flush the console first (riscv_console.h) */
+#define print_endline(s) (console_flush(), print_endline(s))
+#define print_int(s, i) (console_flush(), print_int(s, i))
+#define print_bits(s, b) (console_flush(), print_bits(s, b))
 
 unit print_string(sail_string prefix, sail_string msg);
 
@@ -0,0 +1,411 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "riscv_profile.h"
+#include "riscv_elf.h"
+#include "riscv_platform_impl.h"
+
+/* Hot-spot profiler, see riscv_profile.h */
+
+bool profile_enabled = false;
+static char *profile_out = NULL;
+
+/* Functions of the guest, sorted by address. Two extra indices stand for
+   the code in ROM (CREATOR kernel, reset vector) and for any other PC. */
+struct prof_func {
+  uint64_t start, end;
+  char *name;
+  int rank;
+};
+static struct prof_func *funcs = NULL;
+static int nfuncs = 0;
+#define FUNC_ROM     (nfuncs)
+#define FUNC_UNKNOWN (nfuncs + 1)
+
+/* Retired instructions per PC (open addressing, count == 0 is empty) */
+struct prof_pc {
+  uint64_t pc;
+  uint64_t count;
+  int32_t func;
+};
+static struct prof_pc *pcs = NULL;
+static uint32_t pcs_cap = 0, pcs_used = 0;
+
+/* Call tree built from the shadow stack. Node 0 is the root (no frame);
+   children are found through an open addressed table of node indices. */
+struct prof_node {
+  int32_t parent;
+  int32_t func;
+  uint64_t count;
+};
+static struct prof_node *nodes = NULL;
+static uint32_t nodes_used = 0, nodes_cap = 0;
+static int32_t *children = NULL;
+static uint32_t children_cap = 0;
+
+#define PROFILE_MAX_DEPTH 1024
+static int32_t cur_node = 0;
+static int depth = 0; /* frames past PROFILE_MAX_DEPTH are not pushed */
+static bool pending_call = false;
+static int32_t call_node = 0; /* frame of the last call instruction */
+
+static void *xcalloc(size_t n, size_t size)
+{
+  void *p = calloc(n ? n : 1, size); /* calloc(0) may return NULL */
+  if (p == NULL) {
+    fprintf(stderr, "Out of memory in the profiler\n");
+    exit(1);
+  }
+  return p;
+}
+
+/* ---- ELF symbols ---- */
+
+static int func_cmp(const void *a, const void *b)
+{
+  const struct prof_func *fa = a, *fb = b;
+  if (fa->start != fb->start)
+    return fa->start < fb->start ? -1 : 1;
+  return fb->rank - fa->rank;
+}
+
+/* Collects the FUNC and NOTYPE symbols of executable sections (CREATOR
+   programs are assembly, their labels have no type). */
+static void load_symbols(const char *elf_file)
+{
+  struct elf_file *elf = elf_open(elf_file);
+  struct elf_sym_info sym;
+  uint64_t index = 0, nsyms = 0;
+
+  while (elf_next_symbol(elf, &index, &sym))
+    nsyms++;
+  funcs = xcalloc(nsyms, sizeof(struct prof_func));
+  index = 0;
+  while (elf_next_symbol(elf, &index, &sym)) {
+    if ((sym.type != 0 && sym.type != 2) || !sym.exec) /* STT_NOTYPE, STT_FUNC */
+      continue;
+    if (sym.name[0] == '$' || strncmp(sym.name, ".L", 2) == 0)
+      continue;
+
+    struct prof_func *fn = &funcs[nfuncs++];
+    fn->start = sym.value;
+    fn->end = sym.size ? sym.value + sym.size : sym.section_end;
+    fn->name = strdup(sym.name);
+    fn->rank = (sym.type == 2) * 2 + (sym.bind == 1);
+  }
+  elf_close(elf);
+
+  /* one name per address, the function or global one first */
+  qsort(funcs, nfuncs, sizeof(struct prof_func), func_cmp);
+  int n = 0;
+  for (int i = 0; i < nfuncs; i++) {
+    if (n > 0 && funcs[n - 1].start == funcs[i].start) {
+      free(funcs[i].name);
+      continue;
+    }
+    funcs[n++] = funcs[i];
+  }
+  nfuncs = n;
+  for (int i = 0; i + 1 < nfuncs; i++)
+    if (funcs[i].end > funcs[i + 1].start)
+      funcs[i].end = funcs[i + 1].start;
+}
+
+static int32_t find_func(uint64_t pc)
+{
+  int lo = 0, hi = nfuncs - 1;
+  while (lo <= hi) {
+    int mid = (lo + hi) / 2;
+    if (pc < funcs[mid].start)
+      hi = mid - 1;
+    else if (pc >= funcs[mid].end)
+      lo = mid + 1;
+    else
+      return mid;
+  }
+  if (pc >= rv_rom_base && pc - rv_rom_base < rv_rom_size)
+    return FUNC_ROM;
+  return FUNC_UNKNOWN;
+}
+
+static const char *func_name(int32_t f)
+{
+  if (f < nfuncs)
+    return funcs[f].name;
+  return f == FUNC_ROM ? "[rom]" : "[unknown]";
+}
+
+/* ---- tables ---- */
+
+static inline uint32_t hash64(uint64_t v, uint32_t cap)
+{
+  return (uint32_t)((v * UINT64_C(0x9E3779B97F4A7C15)) >> 32) & (cap - 1);
+}
+
+static void pcs_grow(void)
+{
+  struct prof_pc *old = pcs;
+  uint32_t old_cap = pcs_cap;
+
+  pcs_cap = pcs_cap ? pcs_cap * 2 : 4096;
+  pcs = xcalloc(pcs_cap, sizeof(struct prof_pc));
+  for (uint32_t i = 0; i < old_cap; i++) {
+    if (old[i].count == 0)
+      continue;
+    uint32_t h = hash64(old[i].pc, pcs_cap);
+    while (pcs[h].count)
+      h = (h + 1) & (pcs_cap - 1);
+    pcs[h] = old[i];
+  }
+  free(old);
+}
+
+static inline struct prof_pc *pc_entry(uint64_t pc)
+{
+  uint32_t h = hash64(pc, pcs_cap);
+  while (pcs[h].count) {
+    if (pcs[h].pc == pc)
+      return &pcs[h];
+    h = (h + 1) & (pcs_cap - 1);
+  }
+
+  if (2 * (pcs_used + 1) > pcs_cap) {
+    pcs_grow();
+    return pc_entry(pc);
+  }
+  pcs_used++;
+  pcs[h].pc = pc;
+  pcs[h].func = find_func(pc);
+  return &pcs[h];
+}
+
+static inline uint32_t child_hash(int32_t parent, int32_t func)
+{
+  return hash64(((uint64_t)(uint32_t)parent << 32) | (uint32_t)func, children_cap);
+}
+
+static void children_grow(void)
+{
+  free(children);
+  children_cap = children_cap ? children_cap * 2 : 1024;
+  children = xcalloc(children_cap, sizeof(int32_t));
+  memset(children, 0xff, children_cap * sizeof(int32_t));
+  for (uint32_t i = 1; i < nodes_used; i++) {
+    uint32_t h = child_hash(nodes[i].parent, nodes[i].func);
+    while (children[h] >= 0)
+      h = (h + 1) & (children_cap - 1);
+    children[h] = i;
+  }
+}
+
+static int32_t child(int32_t parent, int32_t func)
+{
+  uint32_t h = child_hash(parent, func);
+  while (children[h] >= 0) {
+    struct prof_node *n = &nodes[children[h]];
+    if (n->parent == parent && n->func == func)
+      return children[h];
+    h = (h + 1) & (children_cap - 1);
+  }
+
+  if (nodes_used == nodes_cap) {
+    nodes_cap *= 2;
+    nodes = realloc(nodes, nodes_cap * sizeof(struct prof_node));
+    if (nodes == NULL) {
+      fprintf(stderr, "Out of memory in the profiler\n");
+      exit(1);
+    }
+  }
+  int32_t i = nodes_used++;
+  nodes[i].parent = parent;
+  nodes[i].func = func;
+  nodes[i].count = 0;
+
+  if (2 * nodes_used > children_cap)
+    children_grow();
+  else
+    children[h] = i;
+  return i;
+}
+
+/* ---- counting ---- */
+
+enum { INSN_OTHER, INSN_CALL, INSN_RET };
+
+#define IS_LINK(r) ((r) == 1 || (r) == 5)
+
+static inline int classify(uint64_t insn)
+{
+  if ((insn & 3) != 3) {
+    uint32_t op = insn & 3, funct3 = (insn >> 13) & 7;
+    uint32_t rs1 = (insn >> 7) & 31, rs2 = (insn >> 2) & 31;
+#ifdef RV32
+    if (op == 1 && funct3 == 1) /* c.jal */
+      return INSN_CALL;
+#endif
+    if (op == 2 && funct3 == 4 && rs2 == 0 && rs1 != 0) {
+      if ((insn >> 12) & 1) /* c.jalr */
+        return INSN_CALL;
+      return IS_LINK(rs1) ? INSN_RET : INSN_OTHER; /* c.jr */
+    }
+    return INSN_OTHER;
+  }
+
+  uint32_t opcode = insn & 0x7f, rd = (insn >> 7) & 31, rs1 = (insn >> 15) & 31;
+  if (opcode == 0x6f) /* jal */
+    return IS_LINK(rd) ? INSN_CALL : INSN_OTHER;
+  if (opcode == 0x67) { /* jalr */
+    if (IS_LINK(rd))
+      return INSN_CALL;
+    if (rd == 0 && IS_LINK(rs1))
+      return INSN_RET;
+  }
+  return INSN_OTHER;
+}
+
+void profile_count(uint64_t pc, uint64_t insn)
+{
+  struct prof_pc *e = pc_entry(pc);
+  e->count++;
+
+  /* the callee frame is pushed on its first instruction */
+  if (pending_call) {
+    pending_call = false;
+    if (depth < PROFILE_MAX_DEPTH)
+      cur_node = child(call_node, e->func);
+    depth++;
+  }
+
+  /* code reached without a call (traps, tail jumps, the start of the
+     program) goes one frame below, and becomes a frame if it calls */
+  int32_t leaf = cur_node;
+  if (nodes[cur_node].func != e->func)
+    leaf = child(cur_node, e->func);
+  nodes[leaf].count++;
+
+  switch (classify(insn)) {
+  case INSN_CALL:
+    pending_call = true;
+    call_node = leaf;
+    break;
+  case INSN_RET:
+    if (depth > 0) {
+      if (depth <= PROFILE_MAX_DEPTH)
+        cur_node = nodes[cur_node].parent;
+      depth--;
+    }
+    break;
+  }
+}
+
+/* ---- setup and output ---- */
+
+void profile_init(const char *elf_file, const char *out_file)
+{
+  profile_reset();
+  load_symbols(elf_file);
+  profile_out = strdup(out_file);
+
+  pcs_grow();
+  nodes_cap = 1024;
+  nodes = xcalloc(nodes_cap, sizeof(struct prof_node));
+  nodes[0].parent = -1;
+  nodes[0].func = -1;
+  nodes_used = 1;
+  children_grow();
+  profile_enabled = true;
+  fprintf(stderr, "profiling into %s (%d symbols)\n", profile_out, nfuncs);
+}
+
+static int count_cmp(const void *a, const void *b)
+{
+  uint64_t ca = ((const struct prof_pc *)a)->count;
+  uint64_t cb = ((const struct prof_pc *)b)->count;
+  return ca < cb ? 1 : ca > cb ? -1 : 0;
+}
+
+void profile_write(void)
+{
+  if (!profile_enabled)
+    return;
+
+  FILE *f = fopen(profile_out, "w");
+  if (f == NULL) {
+    fprintf(stderr, "Cannot open profile output %s\n", profile_out);
+    return;
+  }
+  int32_t *path = xcalloc(PROFILE_MAX_DEPTH + 2, sizeof(int32_t));
+  for (uint32_t i = 1; i < nodes_used; i++) {
+    if (nodes[i].count == 0)
+      continue;
+    int n = 0;
+    for (int32_t j = i; j > 0; j = nodes[j].parent)
+      path[n++] = nodes[j].func;
+    while (n-- > 0)
+      fprintf(f, "%s%c", func_name(path[n]), n ? ';' : ' ');
+    fprintf(f, "%" PRIu64 "\n", nodes[i].count);
+  }
+  free(path);
+  fclose(f);
+
+  /* summary: self counts per function and the hottest PCs */
+  uint64_t total = 0;
+  struct prof_pc *by_func = xcalloc(nfuncs + 2, sizeof(struct prof_pc));
+  struct prof_pc *by_pc = xcalloc(pcs_used, sizeof(struct prof_pc));
+  uint32_t n = 0;
+  for (int32_t i = 0; i < nfuncs + 2; i++)
+    by_func[i].func = i;
+  for (uint32_t i = 0; i < pcs_cap; i++) {
+    if (pcs[i].count == 0)
+      continue;
+    total += pcs[i].count;
+    by_func[pcs[i].func].count += pcs[i].count;
+    by_pc[n++] = pcs[i];
+  }
+  qsort(by_func, nfuncs + 2, sizeof(struct prof_pc), count_cmp);
+  qsort(by_pc, n, sizeof(struct prof_pc), count_cmp);
+
+  fprintf(stderr, "Profile:          %" PRIu64 " instructions, written to %s\n",
+          total, profile_out);
+  for (int i = 0; i < 10 && i < nfuncs + 2 && by_func[i].count; i++)
+    fprintf(stderr, "  %6.2f%% %12" PRIu64 "  %s\n",
+            100.0 * by_func[i].count / total, by_func[i].count,
+            func_name(by_func[i].func));
+  for (uint32_t i = 0; i < 10 && i < n; i++) {
+    int32_t fn = by_pc[i].func;
+    fprintf(stderr, "  %6.2f%% %12" PRIu64 "  0x%08" PRIx64 " %s",
+            100.0 * by_pc[i].count / total, by_pc[i].count, by_pc[i].pc,
+            func_name(fn));
+    if (fn < nfuncs)
+      fprintf(stderr, "+0x%" PRIx64, by_pc[i].pc - funcs[fn].start);
+    fprintf(stderr, "\n");
+  }
+  free(by_func);
+  free(by_pc);
+}
+
+void profile_reset(void)
+{
+  for (int i = 0; i < nfuncs; i++)
+    free(funcs[i].name);
+  free(funcs);
+  free(pcs);
+  free(nodes);
+  free(children);
+  free(profile_out);
+  funcs = NULL;
+  nfuncs = 0;
+  pcs = NULL;
+  pcs_cap = pcs_used = 0;
+  nodes = NULL;
+  nodes_used = nodes_cap = 0;
+  children = NULL;
+  children_cap = 0;
+  profile_out = NULL;
+  cur_node = 0;
+  call_node = 0;
+  depth = 0;
+  pending_call = false;
+  profile_enabled = false;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Hot-spot profiler for the guest program (--profile <file>).
+
+   Counts the retired instructions of every PC and keeps a shadow call stack
+   from the ABI calls and returns (jal/jalr that link ra or t0, jalr/c.jr
+   through them). At the end the counts are written to <file> as folded
+   stacks ("main;foo;bar 1234", the input of flamegraph.pl) and a summary of
+   the hottest functions and PCs goes to stderr. Function names come from
+   the symbol table of the ELF. */
+
+extern bool profile_enabled;
+
+void profile_init(const char *elf_file, const char *out_file);
+void profile_write(void);
+void profile_reset(void);
+
+void profile_count(uint64_t pc, uint64_t insn);
+
+/* Called from run_sail() after every retired instruction */
+static inline void profile_step(uint64_t pc, uint64_t insn)
+{
+  if (profile_enabled)
+    profile_count(pc, insn);
+}
@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "riscv_regview.h"
+#include "riscv_sail.h"
+#ifdef WEBSIM
+  #include <emscripten.h>
+#else
+  #define EMSCRIPTEN_KEEPALIVE
+#endif
+
+/* Register file snapshot, see riscv_regview.h */
+
+static struct sim_regs *regs = NULL;
+static uint64_t dirty[3] = { ~UINT64_C(0), ~UINT64_C(0), ~UINT64_C(0) };
+static bool attached = false;
+static mpz_t vtmp;
+
+static mach_bits *const xregs[32] = {
+  NULL, &zx1,  &zx2,  &zx3,  &zx4,  &zx5,  &zx6,  &zx7,
+  &zx8,  &zx9,  &zx10, &zx11, &zx12, &zx13, &zx14, &zx15,
+  &zx16, &zx17, &zx18, &zx19, &zx20, &zx21, &zx22, &zx23,
+  &zx24, &zx25, &zx26, &zx27, &zx28, &zx29, &zx30, &zx31
+};
+
+static mach_bits *const fregs[32] = {
+  &zf0,  &zf1,  &zf2,  &zf3,  &zf4,  &zf5,  &zf6,  &zf7,
+  &zf8,  &zf9,  &zf10, &zf11, &zf12, &zf13, &zf14, &zf15,
+  &zf16, &zf17, &zf18, &zf19, &zf20, &zf21, &zf22, &zf23,
+  &zf24, &zf25, &zf26, &zf27, &zf28, &zf29, &zf30, &zf31
+};
+
+static sail_bits *const vregs[32] = {
+  &zvr0,  &zvr1,  &zvr2,  &zvr3,  &zvr4,  &zvr5,  &zvr6,  &zvr7,
+  &zvr8,  &zvr9,  &zvr10, &zvr11, &zvr12, &zvr13, &zvr14, &zvr15,
+  &zvr16, &zvr17, &zvr18, &zvr19, &zvr20, &zvr21, &zvr22, &zvr23,
+  &zvr24, &zvr25, &zvr26, &zvr27, &zvr28, &zvr29, &zvr30, &zvr31
+};
+
+unit reg_written(uint8_t file, uint8_t reg)
+{
+  dirty[file] |= UINT64_C(1) << reg;
+  return UNIT;
+}
+
+bool regs_dump(unit u)
+{
+  return !attached;
+}
+
+void regs_invalidate(void)
+{
+  dirty[REGS_FILE_X] = dirty[REGS_FILE_F] = dirty[REGS_FILE_V] = ~UINT64_C(0);
+}
+
+void regs_reset(void)
+{
+  /* init_model() escribe los registros sin pasar por wX/wF/wV */
+  regs_invalidate();
+  attached = false;
+}
+
+static void copy_vreg(int n)
+{
+  uint8_t *out = &regs->v[n * regs->vlenb];
+  size_t count = 0;
+
+  /* vregtype es de vlenmax bits, solo interesan los VLEN de abajo */
+  mpz_tdiv_r_2exp(vtmp, *vregs[n]->bits, regs->vlenb * 8);
+  mpz_export(out, &count, -1, 1, -1, 0, vtmp);
+  memset(out + count, 0, regs->vlenb - count);
+}
+
+static void read_csrs(uint64_t *csr)
+{
+  csr[REGS_MSTATUS] = zmstatus;
+  csr[REGS_MTVEC] = zmtvec.zMtvec_chunk_0;
+  csr[REGS_MEPC] = zmepc;
+  csr[REGS_MCAUSE] = zmcause.zMcause_chunk_0;
+  csr[REGS_MTVAL] = zmtval;
+  csr[REGS_MSCRATCH] = zmscratch;
+  csr[REGS_MCYCLE] = zmcycle;
+  csr[REGS_MINSTRET] = zminstret;
+  csr[REGS_FCSR] = zfcsr.zFcsr_chunk_0;
+  csr[REGS_VSTART] = zvstart;
+  csr[REGS_VL] = zvl;
+  csr[REGS_VTYPE] = zvtype.zVtype_chunk_0;
+}
+
+EMSCRIPTEN_KEEPALIVE struct sim_regs *get_regs(void)
+{
+  uint64_t vlenb = zvlenb;
+
+  if (regs == NULL || regs->vlenb != vlenb) {
+    if (regs == NULL)
+      mpz_init(vtmp);
+    free(regs);
+    regs = calloc(1, sizeof(*regs) + 32 * vlenb);
+    if (regs == NULL) {
+      fprintf(stderr, "Cannot allocate register snapshot\n");
+      exit(1);
+    }
+    regs->vlenb = vlenb;
+    dirty[REGS_FILE_X] = dirty[REGS_FILE_F] = dirty[REGS_FILE_V] = ~UINT64_C(0);
+  }
+  attached = true;
+
+  regs->xlen = zxlen_val;
+  regs->dirty_x = dirty[REGS_FILE_X] & ~UINT64_C(1);
+  regs->dirty_f = dirty[REGS_FILE_F];
+  regs->dirty_v = dirty[REGS_FILE_V];
+  for (int i = 1; i < 32; i++)
+    if (regs->dirty_x >> i & 1)
+      regs->x[i] = *xregs[i];
+  for (int i = 0; i < 32; i++)
+    if (regs->dirty_f >> i & 1)
+      regs->f[i] = *fregs[i];
+  for (int i = 0; i < 32; i++)
+    if (regs->dirty_v >> i & 1)
+      copy_vreg(i);
+
+  uint64_t csr[REGS_CSR_COUNT];
+  read_csrs(csr);
+  regs->dirty_csr = 0;
+  for (int i = 0; i < REGS_CSR_COUNT; i++)
+    if (csr[i] != regs->csr[i]) {
+      regs->dirty_csr |= UINT64_C(1) << i;
+      regs->csr[i] = csr[i];
+    }
+
+  if (regs->dirty_x || regs->dirty_f || regs->dirty_v || regs->dirty_csr
+      || regs->pc != zPC)
+    regs->generation++;
+  regs->pc = zPC;
+  dirty[REGS_FILE_X] = dirty[REGS_FILE_F] = dirty[REGS_FILE_V] = 0;
+  return regs;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "sail.h"
+
+/* Register file snapshot for the IDE.
+
+   get_regs() refreshes a struct sim_regs in linear memory and returns its
+   address, so the host reads the registers with a BigUint64Array (and a
+   Uint8Array for the vector registers) instead of parsing the text dump of
+   print_registers(). It can be called whenever run_sail() has returned:
+   waiting for input, after ebreak or after the program halts.
+
+   wX, wF and wV report every write with reg_written(); the dirty masks of
+   the snapshot have a bit set for each register written since the
+   previous get_regs(), and generation is incremented by every call that
+   found a change, so the host only redraws what changed. Once the host has
+   called get_regs(), htif no longer prints the text dump.
+
+   The layout is fixed: all fields are uint64_t whatever xlen/flen are
+   (values zero-extended) and v[] holds v0..v31 back to back, vlenb bytes
+   each, little endian. The struct is reallocated if vlenb changes, so the
+   host must take the address returned by every call. */
+
+/* Order of csr[] and of the bits of dirty_csr */
+enum regs_csr {
+  REGS_MSTATUS,
+  REGS_MTVEC,
+  REGS_MEPC,
+  REGS_MCAUSE,
+  REGS_MTVAL,
+  REGS_MSCRATCH,
+  REGS_MCYCLE,
+  REGS_MINSTRET,
+  REGS_FCSR,
+  REGS_VSTART,
+  REGS_VL,
+  REGS_VTYPE,
+  REGS_CSR_COUNT
+};
+
+struct sim_regs {
+  uint64_t generation;
+  uint64_t dirty_x;     /* bit n: xn */
+  uint64_t dirty_f;
+  uint64_t dirty_v;
+  uint64_t dirty_csr;   /* bit n: csr[n] */
+  uint64_t xlen;
+  uint64_t vlenb;
+  uint64_t pc;
+  uint64_t x[32];
+  uint64_t f[32];
+  uint64_t csr[REGS_CSR_COUNT];
+  uint8_t v[];          /* 32 * vlenb bytes */
+};
+
+enum regs_file {
+  REGS_FILE_X,
+  REGS_FILE_F,
+  REGS_FILE_V
+};
+
+/* Sail extern, called by wX, wF and wV */
+unit reg_written(uint8_t file, uint8_t reg);
+
+/* Sail extern, false once the host reads the snapshot */
+bool regs_dump(unit u);
+
+void regs_reset(void);
+
+/* Marks every register as written, for changes that do not go through
+   wX/wF/wV (the hart switch of riscv_smp.c) */
+void regs_invalidate(void);
@@ -55,6 +55,8 @@ extern bool have_exception;
 extern uint32_t zcur_privilege;
 
 extern mach_bits zPC;
+extern mach_bits zinstbits;
+extern bool zstep_retired;
 
 extern mach_bits zx1, zx2, zx3, zx4, zx5, zx6, zx7, zx8, zx9, zx10, zx11, zx12,
     zx13, zx14, zx15, zx16, zx17, zx18, zx19, zx20, zx21, zx22, zx23, zx24,
@@ -72,3 +74,104 @@ struct zMcause {
 extern struct zMcause zmcause, zscause;
 
 extern mach_bits zminstret;
+extern mach_bits zmcycle;
+
+struct zCounterin {
+  mach_bits zCounterin_chunk_0;
+};
+extern struct zCounterin zmcountinhibit;
+
+/* Register file snapshot (riscv_regview.c) */
+extern mach_bits zmscratch;
+
+struct zMtvec {
+  mach_bits zMtvec_chunk_0;
+};
+extern struct zMtvec zmtvec;
+
+extern mach_bits zf0, zf1, zf2, zf3, zf4, zf5, zf6, zf7, zf8, zf9, zf10, zf11,
+    zf12, zf13, zf14, zf15, zf16, zf17, zf18, zf19, zf20, zf21, zf22, zf23,
+    zf24, zf25, zf26, zf27, zf28, zf29, zf30, zf31;
+
+struct zFcsr {
+  mach_bits zFcsr_chunk_0;
+};
+extern struct zFcsr zfcsr;
+
+extern sail_bits zvr0, zvr1, zvr2, zvr3, zvr4, zvr5, zvr6, zvr7, zvr8, zvr9,
+    zvr10, zvr11, zvr12, zvr13, zvr14, zvr15, zvr16, zvr17, zvr18, zvr19,
+    zvr20, zvr21, zvr22, zvr23, zvr24, zvr25, zvr26, zvr27, zvr28, zvr29,
+    zvr30, zvr31;
+
+extern mach_bits zvstart, zvl, zvlenb;
+
+struct zVtype {
+  mach_bits zVtype_chunk_0;
+};
+extern struct zVtype zvtype;
+
+/* Per-hart state of --harts (riscv_smp.c) */
+extern mach_bits znextPC, zmhartid, zsscratch;
+
+struct zMinterrupts {
+  mach_bits zMinterrupts_chunk_0;
+};
+extern struct zMinterrupts zmie, zmip, zmideleg;
+
+struct zMedeleg {
+  mach_bits zMedeleg_chunk_0;
+};
+extern struct zMedeleg zmedeleg;
+extern struct zMtvec zstvec;
+
+struct zCounteren {
+  mach_bits zCounteren_chunk_0;
+};
+extern struct zCounteren zmcounteren, zscounteren;
+
+/* TLB lookup statistics (riscv_vmem_tlb.sail) */
+extern mach_bits ztlb_hits, ztlb_misses;
+
+/* Checkpoints (riscv_ckpt.c) */
+extern mach_bits zmtime, zmtimecmp, zsatp, ztselect;
+extern mach_bits zvxsat, zvxrm;
+extern mach_bits zhtif_tohost, zhtif_cmd_write, zhtif_payload_writes;
+
+struct zMstatush {
+  mach_bits zMstatush_chunk_0;
+};
+extern struct zMstatush zmstatush;
+
+struct zSedeleg {
+  mach_bits zSedeleg_chunk_0;
+};
+extern struct zSedeleg zsedeleg;
+
+struct zSinterrupts {
+  mach_bits zSinterrupts_chunk_0;
+};
+extern struct zSinterrupts zsideleg;
+
+struct zMEnvcfg {
+  mach_bits zMEnvcfg_chunk_0;
+};
+extern struct zMEnvcfg zmenvcfg;
+
+struct zSEnvcfg {
+  mach_bits zSEnvcfg_chunk_0;
+};
+extern struct zSEnvcfg zsenvcfg;
+
+struct zVcsr {
+  mach_bits zVcsr_chunk_0;
+};
+extern struct zVcsr zvcsr;
+
+unit zinit_TLB(unit);
+mach_bits zpmpReadCfgReg(mach_int);
+mach_bits zpmpReadAddrReg(mach_int);
+unit zpmpWriteCfgReg(mach_int, mach_bits);
+unit zpmpWriteAddrReg(mach_int, mach_bits);
+
+/* copy_to_guest() (riscv_platform.c) */
+bool zguest_write_allowed(mach_bits, mach_bits);
@@ -11,6 +11,8 @@
 #include <sys/time.h>
 #include <sys/socket.h>
 #include <netinet/ip.h>
+#include <sys/un.h>
+#include <signal.h>
 #include <fcntl.h>
 
 #include "elf.h"
@@ -19,9 +21,24 @@
 #ifdef SAILCOV
 #include "sail_coverage.h"
 #endif
+#ifdef WEBSIM
+#include <emscripten.h>
+#endif
 #include "riscv_platform.h"
 #include "riscv_platform_impl.h"
 #include "riscv_sail.h"
+#include "riscv_profile.h"
+#include "riscv_stats.h"
+#include "riscv_timing.h"
+#include "riscv_bpred.h"
+#include "riscv_sweep.h"
+#include "riscv_trace.h"
+#include "riscv_regview.h"
+#include "riscv_memview.h"
+#include "riscv_batch.h"
+#include "riscv_smp.h"
+#include "riscv_elf.h"
+#include "riscv_ckpt.h"
 
 #ifdef ENABLE_SPIKE
 #include "tv_spike_intf.h"
@@ -95,6 +112,20 @@ enum {
   OPT_PMP_GRAIN,
   OPT_ENABLE_SVINVAL,
   OPT_ENABLE_ZCB,
+  OPT_PROFILE,
+  OPT_TIMING,
+  OPT_BRANCH_PREDICTOR,
+  OPT_CACHE_SWEEP,
+  OPT_CACHE_SWEEP_OUT,
+  OPT_MEM_TRACE,
+  OPT_REPLAY_TRACE,
+  OPT_BATCH,
+  OPT_FORK_SERVER,
+  OPT_HARTS,
+  OPT_SEED,
+  OPT_CHECKPOINT,
+  OPT_RESTORE,
+  OPT_DISABLE_WFI_SKIP,
 };
 
 static bool do_dump_dts = false;
@@ -102,6 +133,16 @@ static bool do_show_times = false;
 struct tv_spike_t *s = NULL;
 char *term_log = NULL;
 static const char *trace_log_path = NULL;
+static const char *profile_path = NULL;
+static const char *sweep_out = NULL;
+static const char *trace_path = NULL;
+static const char *replay_path = NULL;
+static const char *batch_path = NULL;
+static const char *fork_server_path = NULL;
+static const char *restore_path = NULL;
+static mach_bits stop_pc = 0; /* run_sail() vuelve al llegar a este PC */
+static uint64_t random_seed = 0;
+static bool random_seed_set = false;
 FILE *trace_log = NULL;
 char *dtb_file = NULL;
 unsigned char *dtb = NULL;
@@ -247,6 +288,20 @@ static struct option options[] = {
     {"enable-writable-fiom",        no_argument,       0, OPT_ENABLE_WRITABLE_FIOM},
     {"enable-svinval",              no_argument,       0, OPT_ENABLE_SVINVAL      },
     {"enable-zcb",                  no_argument,       0, OPT_ENABLE_ZCB          },
+    {"profile",                     required_argument, 0, OPT_PROFILE             },
+    {"timing",                      optional_argument, 0, OPT_TIMING              },
+    {"branch-predictor",            required_argument, 0, OPT_BRANCH_PREDICTOR    },
+    {"cache-sweep",                 required_argument, 0, OPT_CACHE_SWEEP         },
+    {"cache-sweep-out",             required_argument, 0, OPT_CACHE_SWEEP_OUT     },
+    {"mem-trace",                   required_argument, 0, OPT_MEM_TRACE           },
+    {"replay-trace",                required_argument, 0, OPT_REPLAY_TRACE        },
+    {"batch",                       required_argument, 0, OPT_BATCH               },
+    {"fork-server",                 required_argument, 0, OPT_FORK_SERVER         },
+    {"harts",                       required_argument, 0, OPT_HARTS               },
+    {"seed",                        required_argument, 0, OPT_SEED                },
+    {"checkpoint",                  required_argument, 0, OPT_CHECKPOINT          },
+    {"restore",                     required_argument, 0, OPT_RESTORE             },
+    {"disable-wfi-skip",            no_argument,       0, OPT_DISABLE_WFI_SKIP    },
 #ifdef SAILCOV
     {"sailcov-file",                required_argument, 0, 'c'                     },
 #endif
@@ -353,7 +408,7 @@ static int process_args(int argc, char **argv)
                     "k"
                     "u"
 #endif
-                    "e"
+                    "e:"
                     // "f"
                     "a"
                     "B"
@@ -550,13 +605,92 @@ static int process_args(int argc, char **argv)
       trace_log_path = optarg;
       fprintf(stderr, "using %s for trace output.\n", trace_log_path);
       break;
+    case OPT_PROFILE:
+      profile_path = optarg;
+      break;
+    case OPT_TIMING:
+      timing_init(optarg);
+      break;
+    case OPT_BRANCH_PREDICTOR:
+      bpred_init(optarg);
+      break;
+    case OPT_CACHE_SWEEP:
+      sweep_init(optarg);
+      break;
+    case OPT_CACHE_SWEEP_OUT:
+      sweep_out = optarg;
+      break;
+    case OPT_MEM_TRACE:
+      trace_path = optarg;
+      break;
+    case OPT_REPLAY_TRACE:
+      replay_path = optarg;
+      break;
+    case OPT_BATCH:
+      batch_path = optarg;
+      batch_mode = true;
+      set_config_print(NULL, false);
+      break;
+    case OPT_HARTS:
+      smp_init(optarg);
+      break;
+    case OPT_SEED:
+      random_seed = strtoull(optarg, NULL, 0);
+      random_seed_set = true;
+      break;
+    case OPT_CHECKPOINT:
+      ckpt_init(optarg);
+      break;
+    case OPT_RESTORE:
+      restore_path = optarg;
+      break;
+    case OPT_DISABLE_WFI_SKIP:
+      fprintf(stderr, "disabling WFI timer skip-ahead.\n");
+      rv_enable_wfi_skip = false;
+      break;
+    case OPT_FORK_SERVER:
+      fork_server_path = optarg;
+      batch_mode = true; /* run_sail() vuelve en vez de terminar */
+      set_config_print(NULL, false);
+      break;
     case '?':
       print_usage(argv[0], 1);
       break;
     }
   }
+  if (sweep_out && !sweep_enabled) {
+    fprintf(stderr, "--cache-sweep-out needs --cache-sweep\n");
+    exit(1);
+  }
+  if (replay_path && timing_enabled && !sweep_enabled) {
+    /* Las esperas de memoria salen de la cache del barrido */
+    fprintf(stderr, "--replay-trace with --timing needs --cache-sweep\n");
+    exit(1);
+  }
+  if (replay_path) {
+    /* Sin programa: solo los modelos del harness sobre la traza */
+    uint64_t records = trace_replay(replay_path);
+    fprintf(stderr, "Replayed %" PRIu64 " trace records\n", records);
+    stats_print(stderr);
+    sweep_write(sweep_out);
+    exit(0);
+  }
+  if (batch_path && fork_server_path) {
+    fprintf(stderr, "--batch and --fork-server cannot be used together\n");
+    exit(1);
+  }
+  if (batch_mode && (profile_path || trace_path)) {
+    fprintf(stderr, "--batch and --fork-server cannot be used with --profile or --mem-trace\n");
+    exit(1);
+  }
+  if ((ckpt_every || restore_path) && (batch_mode || smp_harts > 1)) {
+    fprintf(stderr, "--checkpoint and --restore cannot be used with --batch, --fork-server or --harts\n");
+    exit(1);
+  }
   if (do_dump_dts)
     dump_dts();
+  if (batch_path)
+    return optind; /* los ELF vienen del manifiesto */
 #ifdef RVFI_DII
   if (optind > argc || (optind == argc && !rvfi_dii))
     print_usage(argv[0], 0);
@@ -594,33 +728,36 @@ void check_elf(bool is32bit)
 }
 uint64_t load_sail(char *f, bool main_file)
 {
-  bool is32bit;
   uint64_t entry;
   uint64_t begin_sig, end_sig;
-  load_elf(f, &is32bit, &entry);
+  struct elf_file *elf = elf_open(f);
+  check_elf(elf_is32bit(elf));
+  elf_load(elf);
+  entry = elf_entry(elf);
   if (entry != creator_entry)
     entry = creator_entry;
-  check_elf(is32bit);
   if (!main_file) {
     /* Don't scan for test-signature/htif symbols for additional ELF files. */
+    elf_close(elf);
     return entry;
   }
   fprintf(stdout, "ELF Entry @ 0x%" PRIx64 "\n", entry);
   /* locate htif ports */
-  if (lookup_sym(f, "tohost", &rv_htif_tohost) < 0) {
+  if (!elf_symbol(elf, "tohost", &rv_htif_tohost)) {
     fprintf(stderr, "Unable to locate htif tohost port.\n");
     exit(1);
   }
   fprintf(stderr, "tohost located at 0x%0" PRIx64 "\n", rv_htif_tohost);
   /* locate test-signature locations if any */
-  if (!lookup_sym(f, "begin_signature", &begin_sig)) {
+  if (elf_symbol(elf, "begin_signature", &begin_sig)) {
     fprintf(stdout, "begin_signature: 0x%0" PRIx64 "\n", begin_sig);
     mem_sig_start = begin_sig;
   }
-  if (!lookup_sym(f, "end_signature", &end_sig)) {
+  if (elf_symbol(elf, "end_signature", &end_sig)) {
     fprintf(stdout, "end_signature: 0x%0" PRIx64 "\n", end_sig);
     mem_sig_end = end_sig;
   }
+  elf_close(elf);
   return entry;
 }
 
@@ -766,12 +903,11 @@ void init_sail_reset_vector(uint64_t entry)
         is_32bit_model() ? 0x00000193u : 0xffc28113u, 
         0x00000193u, // li gp, 0
         0x00000213u, // li tp, 0
-        0x00000293u, // li t0, 0
         0x00000313u, // li t1, 0
         0x00000393u, // li t2, 0
         0x00000413u, // li s0, 0
         0x00000493u, // li s1, 0
-        0x00000513u, // li a0, 0
+        0xf1402573u, // csrr a0, mhartid (li a0, 0 con una hart)
         0x00000593u, // li a1, 0
         0x00000613u, // li a2, 0
         0x00000693u, // li a3, 0
@@ -794,8 +930,13 @@ void init_sail_reset_vector(uint64_t entry)
         0x00000f13u, // li t5, 0
         0x00000f93u, // li t6, 0
 
-        0xf1402573u, // csrr a0,mhartid
-        0xfe051ee3u, // bnez a0, <reset_vector+0x7c (csrr a0,mhartid)>
+        /* Todas las harts siguen hasta la entrada, cada una con su pila:
+           smp_start() deja en mscratch lo que hay que restar a sp (0 en la
+           hart 0, riscv_smp.h); t0 se sobrescribe despues, no hace falta
+           li t0, 0 */
+        0x340022f3u, // csrr t0, mscratch
+        0x40510133u, // sub sp, sp, t0
+        0x34005073u, // csrwi mscratch, 0
         
         0x00000297u, // auipc t0,0x0 
         0x01028293u, // addi t0,t0,16 
@@ -971,9 +1112,20 @@ void init_sail_reset_vector(uint64_t entry)
   zPC = rv_rom_base;
 }
 
+/* true between model_init() and model_fini() */
+static bool sail_live = false;
+
 void preinit_sail()
 {
   model_init();
+  sail_live = true;
+}
+
+static void fini_sail(void)
+{
+  if (sail_live)
+    model_fini();
+  sail_live = false;
 }
 
 void init_sail(uint64_t elf_entry)
@@ -1002,11 +1154,116 @@ void init_sail(uint64_t elf_entry)
 /* reinitialize to clear state and memory, typically across tests runs */
 void reinit_sail(uint64_t elf_entry)
 {
-  model_fini();
-  model_init();
+  fini_sail();
+  preinit_sail();
   init_sail(elf_entry);
 }
 
+#ifdef WEBSIM
+/* Globales que cambian las opciones: main() guarda sus valores antes del
+   primer callMain() y clear_state() los vuelve a poner */
+#define OPTION_VAR(v) { &v, sizeof(v) }
+
+static const struct {
+  void *var;
+  size_t size;
+} option_vars[] = {
+  OPTION_VAR(rv_ram_size), OPTION_VAR(creator_entry), OPTION_VAR(check_cache),
+  OPTION_VAR(crep_value), OPTION_VAR(kernel), OPTION_VAR(sudo),
+  OPTION_VAR(rv_enable_bext), OPTION_VAR(rv_enable_dirty_update),
+  OPTION_VAR(rv_enable_misaligned), OPTION_VAR(rv_pmp_count), OPTION_VAR(rv_pmp_grain),
+  OPTION_VAR(rv_enable_rvc), OPTION_VAR(rv_enable_next), OPTION_VAR(rv_enable_writable_misa),
+  OPTION_VAR(rv_enable_fdext), OPTION_VAR(rv_enable_vext), OPTION_VAR(rv_enable_zcb),
+  OPTION_VAR(rv_enable_zfinx), OPTION_VAR(rv_mtval_has_illegal_inst_bits),
+  OPTION_VAR(rv_enable_writable_fiom), OPTION_VAR(rv_enable_wfi_skip),
+  OPTION_VAR(do_dump_dts), OPTION_VAR(do_show_times), OPTION_VAR(insn_limit),
+  OPTION_VAR(dtb_file), OPTION_VAR(term_log), OPTION_VAR(sig_file),
+  OPTION_VAR(signature_granularity),
+  OPTION_VAR(config_print_instr), OPTION_VAR(config_print_reg),
+  OPTION_VAR(config_print_mem_access), OPTION_VAR(config_print_platform),
+  OPTION_VAR(config_print_rvfi),
+  OPTION_VAR(trace_log_path), OPTION_VAR(profile_path), OPTION_VAR(sweep_out),
+  OPTION_VAR(trace_path), OPTION_VAR(replay_path), OPTION_VAR(batch_path),
+  OPTION_VAR(batch_mode), OPTION_VAR(fork_server_path), OPTION_VAR(restore_path),
+  OPTION_VAR(random_seed), OPTION_VAR(random_seed_set),
+};
+
+#define OPTION_NVARS (sizeof(option_vars) / sizeof(option_vars[0]))
+
+static uint8_t *option_defaults = NULL;
+
+static void save_option_defaults(void)
+{
+  size_t size = 0;
+  for (size_t i = 0; i < OPTION_NVARS; i++)
+    size += option_vars[i].size;
+  option_defaults = malloc(size);
+  if (option_defaults == NULL) {
+    fprintf(stderr, "Cannot allocate the option defaults\n");
+    exit(1);
+  }
+  uint8_t *p = option_defaults;
+  for (size_t i = 0; i < OPTION_NVARS; i++) {
+    memcpy(p, option_vars[i].var, option_vars[i].size);
+    p += option_vars[i].size;
+  }
+}
+
+static void restore_option_defaults(void)
+{
+  const uint8_t *p = option_defaults;
+  for (size_t i = 0; i < OPTION_NVARS; i++) {
+    memcpy(option_vars[i].var, p, option_vars[i].size);
+    p += option_vars[i].size;
+  }
+}
+
+/* Arguments of the last callMain(), copied because callMain() frees its
+   own when main() returns; reset() loads the same program again */
+static int saved_argc = 0;
+static char **saved_argv = NULL;
+
+static void save_args(int argc, char **argv)
+{
+  for (int i = 0; i < saved_argc; i++)
+    free(saved_argv[i]);
+  free(saved_argv);
+  saved_argv = calloc(argc + 1, sizeof(char *));
+  if (saved_argv == NULL) {
+    fprintf(stderr, "Cannot allocate the arguments\n");
+    exit(1);
+  }
+  for (int i = 0; i < argc; i++)
+    saved_argv[i] = strdup(argv[i]);
+  saved_argc = argc;
+}
+
+/* Finalizes the model if the last run did not get to finish() (e.g. it was
+   stopped from the IDE) and clears the state of the harness and the
+   options, as before the first callMain() */
+static void clear_state(void)
+{
+  fini_sail();
+  console_clear();
+  platform_reset();
+  profile_reset();
+  stats_reset();
+  timing_reset();
+  bpred_reset();
+  sweep_reset();
+  regs_reset();
+  memview_reset();
+  smp_reset();
+  ckpt_reset();
+  trace_stop();
+  restore_option_defaults();
+  total_insns = 0;
+  mem_sig_start = 0;
+  mem_sig_end = 0;
+  optind = 0; /* getopt vuelve a empezar */
+}
+#endif
+
 int init_check(struct tv_spike_t *s)
 {
   int passed = 1;
@@ -1057,10 +1314,14 @@ void close_logs(void)
 
 void finish(int ec)
 {
+  console_flush();
   if (sig_file)
     write_signature(sig_file);
+  profile_write();
+  sweep_write(sweep_out);
+  trace_stop();
 
-  model_fini();
+  fini_sail();
 #ifdef ENABLE_SPIKE
   tv_free(s);
 #endif
@@ -1078,6 +1339,12 @@ void finish(int ec)
     fprintf(stderr, "Execution:        %d msecs\n", exec_msecs);
     fprintf(stderr, "Instructions:     %d\n", total_insns);
     fprintf(stderr, "Perf:             %.3f Kips\n", Kips);
+    fprintf(stderr, "Random seed:      %" PRIu64 "\n", random_seed);
+    uint64_t tlb_lookups = ztlb_hits + ztlb_misses;
+    if (tlb_lookups)
+      fprintf(stderr, "TLB hits:         %" PRIu64 "/%" PRIu64 " (%.2f%%)\n",
+              ztlb_hits, tlb_lookups, 100.0 * ztlb_hits / tlb_lookups);
+    stats_print(stderr);
   }
   close_logs();
   exit(ec);
@@ -1236,6 +1503,7 @@ void run_sail(void)
   }
 
   while (!zhtif_done && (insn_limit == 0 || total_insns < insn_limit)) {
+    mach_bits step_pc = zPC;
 #ifdef RVFI_DII
     if (rvfi_dii) {
       mach_bits instr_bits;
@@ -1350,6 +1618,20 @@ void run_sail(void)
       step_no++;
       insn_cnt++;
       total_insns++;
+      /* Como minstret: las instrucciones que trapean no se cuentan */
+      if (zstep_retired) {
+        stats_count(step_pc, zPC, zinstbits);
+        if (trace_enabled)
+          trace_retire(step_pc, zinstbits, zPC);
+      }
+      if (timing_enabled) {
+        uint64_t cycles = timing_count(step_pc, zPC, zinstbits);
+        if (!(zmcountinhibit.zCounterin_chunk_0 & 1)) /* CY */
+          zmcycle += cycles;
+      }
+      profile_step(step_pc, zinstbits);
+      if (smp_harts > 1)
+        smp_step();
     }
 
     if (do_show_times && (total_insns & 0xfffff) == 0) {
@@ -1361,6 +1643,7 @@ void run_sail(void)
       }
       uint64_t end_us = 1000000 * ((uint64_t)interval_start.tv_sec)
           + ((uint64_t)interval_start.tv_usec);
+      console_flush();
       fprintf(stdout, "kips: %" PRIu64 "\n",
               ((uint64_t)1000) * 0x100000 / (end_us - start_us));
     }
@@ -1371,6 +1654,7 @@ void run_sail(void)
       flush_logs();
     }
 
+    console_flush();
     if (zhtif_done) {
       if (!spike_done) {
         fprintf(stdout, "Sail done (exit-code %" PRIi64 "), but not Spike!\n",
@@ -1391,18 +1675,29 @@ void run_sail(void)
     if (zhtif_done) {
       // _print_registers();
       /* check exit code */
+      console_flush();
       if (zhtif_exit_code == 0)
         fprintf(stdout, "SUCCESS\n");
       else
         fprintf(stdout, "FAILURE: %" PRIi64 "\n", zhtif_exit_code);
     }
 
+    if (batch_mode && (total_insns & 0x3ff) == 0 && batch_expired())
+      break;
+    if (stop_pc && zPC == stop_pc)
+      break;
+
     if (insn_cnt == rv_insns_per_tick) {
       insn_cnt = 0;
+      mach_bits mcycle = zmcycle;
       ztick_clock(UNIT);
+      if (timing_enabled)
+        zmcycle = mcycle; /* ya lo ha avanzado el modelo de tiempos */
       ztick_platform(UNIT);
 
       tick_spike();
+      if (ckpt_every)
+        ckpt_step(total_insns);
     }
   }
 
@@ -1410,6 +1705,8 @@ dump_state:
   if (diverged) {
     /* TODO */
   }
+  if (batch_mode)
+    return; /* run_batch() sigue con el siguiente programa */
   finish(diverged);
 
 step_exception:
@@ -1452,20 +1749,200 @@ void init_logs()
 #endif
 }
 
-int main(int argc, char **argv)
+/* Runs the loaded program to the end capturing its console output */
+static void run_job(uint64_t ms, struct batch_result *r, char **output, size_t *len)
+{
+  FILE *capture = open_memstream(output, len);
+  if (capture == NULL) {
+    fprintf(stderr, "Cannot capture the program output\n");
+    exit(1);
+  }
+  console_set_output(capture);
+  batch_start(ms);
+  run_sail();
+  console_flush();
+  console_set_output(NULL);
+  fclose(capture);
+
+  if (have_exception) {
+    r->status = BATCH_ERROR;
+    r->error = "Sail exception";
+  } else if (zhtif_done)
+    r->status = BATCH_HALTED;
+  else if (batch_expired())
+    r->status = BATCH_TIMEOUT;
+  else
+    r->status = BATCH_INSN_LIMIT;
+  r->exit_code = zhtif_exit_code;
+  r->instructions = total_insns;
+  r->ms = batch_elapsed();
+}
+
+/* Lo que comprueba load_sail() saliendo, para dar un error de un solo
+   trabajo de --batch; NULL si el programa se puede cargar */
+static const char *check_program(const char *path)
+{
+  const char *error;
+  uint64_t tohost;
+  struct elf_file *elf = elf_try_open(path, &error);
+  if (elf == NULL)
+    return error;
+  if (elf_is32bit(elf) != is_32bit_model())
+    error = elf_is32bit(elf) ? "32-bit ELF not supported by RV64 model"
+                             : "64-bit ELF not supported by RV32 model";
+  else if (!elf_symbol(elf, "tohost", &tohost))
+    error = "Unable to locate htif tohost port";
+  elf_close(elf);
+  return error;
+}
+
+/* --batch: every job of the manifest from a clean model, see riscv_batch.h */
+static void run_batch(void)
+{
+  struct batch_reader *b = batch_open(batch_path);
+  struct batch_job job;
+  int default_limit = insn_limit;
+
+  /* stdout solo lleva los resultados, el resto de mensajes va a stderr */
+  FILE *results = fdopen(dup(STDOUT_FILENO), "w");
+  if (results == NULL || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+    fprintf(stderr, "Cannot set up batch output: %s\n", strerror(errno));
+    exit(1);
+  }
+
+  while (batch_next(b, &job)) {
+    struct batch_result r = {0};
+    const char *input = job.input ? job.input : "/dev/null";
+
+    if (access(job.elf, R_OK) != 0 || freopen(input, "r", stdin) == NULL) {
+      r.status = BATCH_ERROR;
+      r.error = strerror(errno);
+      batch_report(results, &job, &r, NULL, 0);
+      continue;
+    }
+    if ((r.error = check_program(job.elf)) != NULL) {
+      r.status = BATCH_ERROR;
+      batch_report(results, &job, &r, NULL, 0);
+      continue;
+    }
+
+    fini_sail();
+    preinit_sail();
+    platform_reset();
+    debug_mode = false;
+    console_clear();
+    stats_reset();
+    timing_clear();
+    bpred_clear();
+    have_exception = false;
+    rv_random_init(random_seed); /* cada trabajo con la misma semilla: resultados reproducibles */
+    mem_sig_start = mem_sig_end = 0;
+    total_insns = 0;
+    insn_limit = job.insns ? (int)job.insns : default_limit;
+    init_sail(load_sail(job.elf, /*main_file=*/true));
+    smp_start();
+
+    char *output = NULL;
+    size_t len = 0;
+    run_job(job.ms, &r, &output, &len);
+    batch_report(results, &job, &r, output, len);
+    free(output);
+  }
+  batch_close(b);
+  fclose(results);
+  finish(0);
+}
+
+/* --fork-server <socket>: the ELF is loaded and run through the reset
+   vector up to its entry point once, then every connection to the Unix
+   socket is served by a fork() of that state (copy on write). The client
+   sends the stdin of the program (ecalls 5-8) and closes its write side;
+   the answer is one JSON line (batch_reply()) with the status, exit code,
+   instructions, time and console output, and the connection is closed.
+   The limits are those of the command line (--inst-limit). */
+static void run_fork_server(uint64_t entry)
+{
+  debug_mode = false;
+  stop_pc = entry;
+  run_sail();
+  stop_pc = 0;
+  if (zhtif_done || have_exception || zPC != entry) {
+    fprintf(stderr, "The program did not reach its entry point 0x%" PRIx64 "\n", entry);
+    exit(1);
+  }
+  total_insns = 0;
+  console_clear();
+
+  struct sockaddr_un addr = {.sun_family = AF_UNIX};
+  if (strlen(fork_server_path) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "Socket path too long: %s\n", fork_server_path);
+    exit(1);
+  }
+  strcpy(addr.sun_path, fork_server_path);
+  unlink(fork_server_path);
+  int listen_sock = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_sock == -1
+      || bind(listen_sock, (struct sockaddr *)&addr, sizeof(addr)) == -1
+      || listen(listen_sock, 64) == -1) {
+    fprintf(stderr, "Unable to listen on %s: %s\n", fork_server_path, strerror(errno));
+    exit(1);
+  }
+  signal(SIGCHLD, SIG_IGN); /* sin zombis: nadie espera a los hijos */
+  fprintf(stderr, "Fork server listening on %s\n", fork_server_path);
+
+  for (;;) {
+    int conn = accept(listen_sock, NULL, NULL);
+    if (conn == -1) {
+      if (errno == EINTR)
+        continue;
+      fprintf(stderr, "Unable to accept connection: %s\n", strerror(errno));
+      exit(1);
+    }
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid == 0) {
+      close(listen_sock);
+      if (dup2(conn, STDIN_FILENO) < 0)
+        _exit(1);
+      clearerr(stdin);
+
+      struct batch_result r = {0};
+      char *output = NULL;
+      size_t len = 0;
+      run_job(0, &r, &output, &len);
+      FILE *reply = fdopen(conn, "w");
+      if (reply != NULL)
+        batch_reply(reply, &r, output, len);
+      _exit(0);
+    }
+    if (pid == -1)
+      fprintf(stderr, "Unable to fork: %s\n", strerror(errno));
+    close(conn);
+  }
+}
+
+/* Everything main() does before running: options, model, ELF files,
+   harness models. Returns the entry point. */
+static uint64_t setup(int argc, char **argv)
 {
-  srand(time(NULL));
   // Initialize model so that we can check or report its architecture.
   preinit_sail();
 
   int files_start = process_args(argc, argv);
   char *initial_elf_file = argv[files_start];
+  if (!random_seed_set)
+    random_seed = (uint64_t)time(NULL) ^ (uint64_t)getpid() << 32;
+  rv_random_init(random_seed);
   init_logs();
 
   if (gettimeofday(&init_start, NULL) < 0) {
     fprintf(stderr, "Cannot gettimeofday: %s\n", strerror(errno));
     exit(1);
   }
+  if (batch_path) {
+    init_end = init_start;
+    run_batch();
+  }
 
 #ifdef RVFI_DII
   uint64_t entry;
@@ -1474,7 +1951,7 @@ int main(int argc, char **argv)
     int listen_sock = socket(AF_INET, SOCK_STREAM, 0);
     if (listen_sock == -1) {
       fprintf(stderr, "Unable to create socket: %s\n", strerror(errno));
-      return 1;
+      exit(1);
     }
     int reuseaddr = 1;
     if (setsockopt(listen_sock, SOL_SOCKET, SO_REUSEADDR, &reuseaddr,
@@ -1482,38 +1959,38 @@ int main(int argc, char **argv)
         == -1) {
       fprintf(stderr, "Unable to set reuseaddr on socket: %s\n",
               strerror(errno));
-      return 1;
+      exit(1);
     }
     struct sockaddr_in addr = {.sin_family = AF_INET,
                                .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
                                .sin_port = htons(rvfi_dii_port)};
     if (bind(listen_sock, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
       fprintf(stderr, "Unable to set bind socket: %s\n", strerror(errno));
-      return 1;
+      exit(1);
     }
     if (listen(listen_sock, 1) == -1) {
       fprintf(stderr, "Unable to listen on socket: %s\n", strerror(errno));
-      return 1;
+      exit(1);
     }
     socklen_t addrlen = sizeof(addr);
     if (getsockname(listen_sock, (struct sockaddr *)&addr, &addrlen) == -1) {
       fprintf(stderr, "Unable to getsockname() on socket: %s\n",
               strerror(errno));
-      return 1;
+      exit(1);
     }
     printf("Waiting for connection on port %d.\n", ntohs(addr.sin_port));
     rvfi_dii_sock = accept(listen_sock, NULL, NULL);
     if (rvfi_dii_sock == -1) {
       fprintf(stderr, "Unable to accept connection on socket: %s\n",
               strerror(errno));
-      return 1;
+      exit(1);
     }
     close(listen_sock);
     // Ensure that the socket is blocking
     int fd_flags = fcntl(rvfi_dii_sock, F_GETFL);
     if (fd_flags == -1) {
       fprintf(stderr, "Failed to get file descriptor flags for socket!\n");
-      return 1;
+      exit(1);
     }
     if (config_print_rvfi) {
       fprintf(stderr, "RVFI socket fd flags=%d, nonblocking=%d\n", fd_flags,
@@ -1521,7 +1998,7 @@ int main(int argc, char **argv)
     }
     if (fd_flags & O_NONBLOCK) {
       fprintf(stderr, "Socket was non-blocking, this will not work!\n");
-      return 1;
+      exit(1);
     }
     printf("Connected\n");
   } else
@@ -1541,6 +2018,16 @@ int main(int argc, char **argv)
    */
   init_spike(initial_elf_file, entry, rv_ram_size);
   init_sail(entry);
+  smp_start();
+  memview_init(rv_ram_base, rv_ram_size);
+  if (restore_path)
+    total_insns = ckpt_restore(restore_path);
+  if (fork_server_path)
+    run_fork_server(entry);
+  if (profile_path)
+    profile_init(initial_elf_file, profile_path);
+  if (trace_path)
+    trace_start(trace_path, zxlen_val);
 
   if (!init_check(s))
     finish(1);
@@ -1550,6 +2037,52 @@ int main(int argc, char **argv)
     exit(1);
   }
 
+  return entry;
+}
+
+static void end_program(void)
+{
+  fini_sail();
+  console_flush();
+  flush_logs();
+  close_logs();
+}
+
+#ifdef WEBSIM
+/* Runs the same program again on this instance: the model is created
+   again (as reinit_sail() does), the ELF files of the last callMain() are
+   loaded again with the same options and the harness starts from zero.
+   run_program() then runs it (from the host with ccall(..., {async: true}),
+   it pauses like main()); a new callMain() loads another program. */
+EMSCRIPTEN_KEEPALIVE void reset(void)
+{
+  clear_state();
+  if (saved_argv)
+    setup(saved_argc, saved_argv);
+}
+
+EMSCRIPTEN_KEEPALIVE void run_program(void)
+{
+  run_sail();
+  end_program();
+}
+#endif
+
+int main(int argc, char **argv)
+{
+#ifdef WEBSIM
+  if (option_defaults == NULL)
+    save_option_defaults();
+  if (saved_argv)
+    clear_state(); /* otro programa en el mismo modulo */
+  save_args(argc, argv);
+#endif
+#ifdef RVFI_DII
+  uint64_t entry = setup(argc, argv);
+#else
+  setup(argc, argv);
+#endif
+
   do {
     run_sail();
 #ifndef RVFI_DII
@@ -1561,7 +2094,5 @@ int main(int argc, char **argv)
     }
   } while (rvfi_dii);
 #endif
-  model_fini();
-  flush_logs();
-  close_logs();
+  end_program();
 }
@@ -0,0 +1,205 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sail.h"
+#include "riscv_smp.h"
+#include "riscv_sail.h"
+#include "riscv_platform.h"
+#include "riscv_platform_impl.h"
+#include "riscv_regview.h"
+
+/* Multi-hart simulation, see riscv_smp.h */
+
+unsigned smp_harts = 1;
+unsigned smp_hart = 0;
+
+static uint64_t quantum = 100;
+static uint64_t slice = 0;
+
+#define HART_REG(r) { &r, sizeof(r) }
+
+/* Registros de la hart que se intercambian en cada cambio de turno */
+static const struct {
+  void *reg;
+  size_t size;
+} hart_regs[] = {
+  HART_REG(zPC), HART_REG(znextPC), HART_REG(zcur_privilege),
+  HART_REG(zx1), HART_REG(zx2), HART_REG(zx3), HART_REG(zx4),
+  HART_REG(zx5), HART_REG(zx6), HART_REG(zx7), HART_REG(zx8),
+  HART_REG(zx9), HART_REG(zx10), HART_REG(zx11), HART_REG(zx12),
+  HART_REG(zx13), HART_REG(zx14), HART_REG(zx15), HART_REG(zx16),
+  HART_REG(zx17), HART_REG(zx18), HART_REG(zx19), HART_REG(zx20),
+  HART_REG(zx21), HART_REG(zx22), HART_REG(zx23), HART_REG(zx24),
+  HART_REG(zx25), HART_REG(zx26), HART_REG(zx27), HART_REG(zx28),
+  HART_REG(zx29), HART_REG(zx30), HART_REG(zx31),
+  HART_REG(zf0), HART_REG(zf1), HART_REG(zf2), HART_REG(zf3),
+  HART_REG(zf4), HART_REG(zf5), HART_REG(zf6), HART_REG(zf7),
+  HART_REG(zf8), HART_REG(zf9), HART_REG(zf10), HART_REG(zf11),
+  HART_REG(zf12), HART_REG(zf13), HART_REG(zf14), HART_REG(zf15),
+  HART_REG(zf16), HART_REG(zf17), HART_REG(zf18), HART_REG(zf19),
+  HART_REG(zf20), HART_REG(zf21), HART_REG(zf22), HART_REG(zf23),
+  HART_REG(zf24), HART_REG(zf25), HART_REG(zf26), HART_REG(zf27),
+  HART_REG(zf28), HART_REG(zf29), HART_REG(zf30), HART_REG(zf31),
+  HART_REG(zfcsr),
+  HART_REG(zmstatus), HART_REG(zmtvec), HART_REG(zmepc), HART_REG(zmcause),
+  HART_REG(zmtval), HART_REG(zmscratch), HART_REG(zmie), HART_REG(zmip),
+  HART_REG(zmideleg), HART_REG(zmedeleg), HART_REG(zmhartid),
+  HART_REG(zminstret), HART_REG(zmcounteren), HART_REG(zscounteren),
+  HART_REG(zstvec), HART_REG(zsepc), HART_REG(zscause), HART_REG(zstval),
+  HART_REG(zsscratch), HART_REG(zsatp), HART_REG(zmcycle), HART_REG(zmtimecmp),
+  HART_REG(zvtype), HART_REG(zvl), HART_REG(zvstart), HART_REG(zvcsr),
+  HART_REG(zvxsat), HART_REG(zvxrm),
+};
+
+#define HART_NREGS (sizeof(hart_regs) / sizeof(hart_regs[0]))
+
+static uint8_t *hart_state[SMP_MAX_HARTS];
+static size_t hart_size = 0;
+
+/* Registros vectoriales, solo con V */
+static sail_bits *const vregs[32] = {
+  &zvr0,  &zvr1,  &zvr2,  &zvr3,  &zvr4,  &zvr5,  &zvr6,  &zvr7,
+  &zvr8,  &zvr9,  &zvr10, &zvr11, &zvr12, &zvr13, &zvr14, &zvr15,
+  &zvr16, &zvr17, &zvr18, &zvr19, &zvr20, &zvr21, &zvr22, &zvr23,
+  &zvr24, &zvr25, &zvr26, &zvr27, &zvr28, &zvr29, &zvr30, &zvr31
+};
+static mpz_t hart_vregs[SMP_MAX_HARTS][32];
+static bool hart_vregs_init = false;
+
+void smp_init(const char *spec)
+{
+  char *copy = strdup(spec);
+  for (char *tok = strtok(copy, ","); tok; tok = strtok(NULL, ",")) {
+    char *end;
+    if (strncmp(tok, "quantum=", 8) == 0) {
+      quantum = strtoull(tok + 8, &end, 0);
+      if (*end != '\0' || quantum == 0) {
+        fprintf(stderr, "Invalid hart quantum '%s'\n", tok + 8);
+        exit(1);
+      }
+    } else {
+      smp_harts = strtoul(tok, &end, 0);
+      if (*end != '\0' || smp_harts == 0 || smp_harts > SMP_MAX_HARTS) {
+        fprintf(stderr, "Invalid number of harts '%s' (1-%d)\n", tok, SMP_MAX_HARTS);
+        exit(1);
+      }
+    }
+  }
+  free(copy);
+}
+
+static void save_hart(unsigned h)
+{
+  uint8_t *p = hart_state[h];
+  for (size_t i = 0; i < HART_NREGS; i++) {
+    memcpy(p, hart_regs[i].reg, hart_regs[i].size);
+    p += hart_regs[i].size;
+  }
+  if (hart_vregs_init)
+    for (int i = 0; i < 32; i++)
+      mpz_set(hart_vregs[h][i], *vregs[i]->bits);
+}
+
+static void load_hart(unsigned h)
+{
+  const uint8_t *p = hart_state[h];
+  for (size_t i = 0; i < HART_NREGS; i++) {
+    memcpy(hart_regs[i].reg, p, hart_regs[i].size);
+    p += hart_regs[i].size;
+  }
+  if (hart_vregs_init)
+    for (int i = 0; i < 32; i++)
+      mpz_set(*vregs[i]->bits, hart_vregs[h][i]);
+}
+
+/* Pilas de las harts 1..N-1 con el kernel, ver riscv_smp.h; devuelve
+   el final de la zona (la pila de la hart 1) */
+static uint64_t check_stacks(void)
+{
+  uint64_t ram_end = rv_ram_base + rv_ram_size;
+  uint64_t top = SMP_KERNEL_STACK == ram_end ? ram_end - SMP_STACK_SIZE : ram_end;
+  uint64_t need = (uint64_t)(smp_harts - 1) * SMP_STACK_SIZE;
+  uint64_t low = top - need;
+
+  if (top < rv_ram_base || top - rv_ram_base < need
+      || (rv_htif_tohost < top && rv_htif_tohost + 16 > low)
+      || (SMP_KERNEL_STACK - SMP_STACK_SIZE < top && SMP_KERNEL_STACK > low)) {
+    fprintf(stderr, "--harts %u needs %" PRIu64 " KiB of stacks at the top of RAM, "
+            "clear of tohost and of the stack of hart 0 (more RAM with -z)\n",
+            smp_harts, need >> 10);
+    exit(1);
+  }
+  return top;
+}
+
+void smp_start(void)
+{
+  if (smp_harts <= 1)
+    return;
+
+  uint64_t top = kernel_sim() ? check_stacks() : 0;
+  uint64_t mask = zxlen_val == 32 ? UINT32_MAX : UINT64_MAX;
+
+  hart_size = 0;
+  for (size_t i = 0; i < HART_NREGS; i++)
+    hart_size += hart_regs[i].size;
+  if (rv_enable_vext && !hart_vregs_init) {
+    for (unsigned h = 0; h < SMP_MAX_HARTS; h++)
+      for (int i = 0; i < 32; i++)
+        mpz_init(hart_vregs[h][i]);
+    hart_vregs_init = true;
+  }
+  for (unsigned h = 0; h < smp_harts; h++) {
+    free(hart_state[h]);
+    hart_state[h] = malloc(hart_size);
+    if (hart_state[h] == NULL) {
+      fprintf(stderr, "Cannot allocate hart state\n");
+      exit(1);
+    }
+    zmhartid = h;
+    if (top && h > 0) /* el reset vector hace sp -= mscratch */
+      zmscratch = (SMP_KERNEL_STACK - (top - (h - 1) * SMP_STACK_SIZE)) & mask;
+    save_hart(h);
+  }
+  smp_hart = 0;
+  slice = 0;
+  load_hart(0);
+  regs_invalidate();
+}
+
+void smp_reset(void)
+{
+  for (unsigned h = 0; h < SMP_MAX_HARTS; h++) {
+    free(hart_state[h]);
+    hart_state[h] = NULL;
+  }
+  if (hart_vregs_init) {
+    for (unsigned h = 0; h < SMP_MAX_HARTS; h++)
+      for (int i = 0; i < 32; i++)
+        mpz_clear(hart_vregs[h][i]);
+    hart_vregs_init = false;
+  }
+  smp_harts = 1;
+  smp_hart = 0;
+  quantum = 100;
+  slice = 0;
+}
+
+void smp_step(void)
+{
+  if (++slice < quantum)
+    return;
+  slice = 0;
+  mach_bits satp = zsatp;
+  save_hart(smp_hart);
+  smp_hart = (smp_hart + 1) % smp_harts;
+  load_hart(smp_hart);
+  regs_invalidate();
+
+  /* Una sola TLB y una cache de PMP en el modelo: la TLB vale mientras el
+     espacio de direcciones sea el mismo, la cache depende de mstatus.MPRV */
+  if (zsatp != satp)
+    zinit_TLB(UNIT);
+  pmp_cache_flush(UNIT);
+}
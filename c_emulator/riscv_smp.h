@@ -0,0 +1,55 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Multi-hart simulation (--harts N[,quantum=Q]).
+
+   The Sail model has one hart, so the harness multiplexes N of them on
+   it: every hart has its own copy of the architectural state (PC, x, f,
+   fcsr, privilege, the M and S trap CSRs, mie/mip, counter enables,
+   minstret and mhartid) and run_sail() swaps it in and out in a
+   deterministic round robin, Q retired instructions per turn (100 by
+   default). Memory is shared, so AMOs are atomic between harts for free,
+   and every hart has its own LR/SC reservation, cancelled when another
+   hart stores to its 8-byte granule (riscv_platform.c).
+
+   Also per hart: satp, mcycle, mtimecmp and, with V, the vector registers
+   and CSRs. The model has one TLB and one PMP decision cache: the TLB is
+   flushed when the incoming hart has another satp and the PMP cache on
+   every switch. The PMP entries and mtime are shared (the kernel reset
+   vector programs the same PMP on every hart). The CLINT has a single
+   mtimecmp address, so a guest store to it reaches the hart that is
+   running: each hart can only program its own timer.
+
+   All harts start at the reset vector with their mhartid, which passes it
+   in a0 to the program entry. With the kernel (-k) hart 0 keeps the stack
+   below SMP_KERNEL_STACK and harts 1..N-1 get SMP_STACK_SIZE bytes each,
+   down from the top of RAM (from below the stack of hart 0 when that is
+   the top, as on RV64), so the program must leave those bytes free.
+   smp_start() checks that they are in RAM and clear of tohost and of the
+   stack of hart 0 (on RV32 that needs -z), and leaves in mscratch what
+   the reset vector subtracts from sp; the reset vector then clears it.
+   The first hart to write tohost ends the simulation. Up to SMP_MAX_HARTS
+   harts. */
+
+#define SMP_MAX_HARTS 8
+#define SMP_STACK_SIZE (64 << 10)
+
+/* Top of the stack of hart 0, as set by the kernel reset vector */
+#ifdef RV32
+#define SMP_KERNEL_STACK UINT64_C(0x80007000)
+#else
+#define SMP_KERNEL_STACK UINT64_C(0x40000000)
+#endif
+
+extern unsigned smp_harts; /* 1: single hart, nothing is swapped */
+extern unsigned smp_hart;  /* hart running now */
+
+void smp_init(const char *spec);
+
+/* After init_sail(): all harts get the reset state */
+void smp_start(void);
+void smp_reset(void);
+
+/* Called from run_sail() for each retired instruction */
+void smp_step(void);
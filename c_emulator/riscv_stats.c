@@ -0,0 +1,214 @@
+#include <inttypes.h>
+#include <string.h>
+#include "riscv_stats.h"
+#include "riscv_timing.h"
+#ifdef WEBSIM
+  #include <emscripten.h>
+#else
+  #define EMSCRIPTEN_KEEPALIVE
+#endif
+
+/* Execution counters, see riscv_stats.h */
+
+struct sim_stats sim_stats;
+
+static const char *cache_names[SIM_CACHE_COUNT] = {
+  "L1", "L1_I", "L1_D", "L2", "L2_I", "L2_D"
+};
+
+static void count_branch(uint64_t pc, uint64_t next_pc, uint64_t len)
+{
+  if (next_pc != pc + len)
+    sim_stats.branch_taken++;
+  else
+    sim_stats.branch_not_taken++;
+}
+
+/* Instrucciones comprimidas (extension C y Zcb) */
+static void count_compressed(uint64_t pc, uint64_t next_pc, uint32_t insn)
+{
+  uint32_t funct3 = (insn >> 13) & 0x7;
+
+  switch (insn & 0x3) {
+  case 0:
+    if (funct3 == 0)
+      sim_stats.alu++;                          /* c.addi4spn */
+    else if (funct3 == 4)                       /* Zcb: c.lbu, c.lh(u), c.sb, c.sh */
+      ((insn >> 11) & 1) ? sim_stats.store++ : sim_stats.load++;
+    else if (funct3 < 4)
+      sim_stats.load++;
+    else
+      sim_stats.store++;
+    break;
+  case 1:
+#ifdef RV32
+    if (funct3 == 1 || funct3 == 5)             /* c.jal, c.j */
+#else
+    if (funct3 == 5)                            /* c.j (001 es c.addiw) */
+#endif
+      sim_stats.jump++;
+    else if (funct3 >= 6)                       /* c.beqz, c.bnez */
+      count_branch(pc, next_pc, 2);
+    else
+      sim_stats.alu++;
+    break;
+  case 2:
+    if (funct3 == 0) {
+      sim_stats.alu++;                          /* c.slli */
+    } else if (funct3 < 4) {
+      sim_stats.load++;
+    } else if (funct3 > 4) {
+      sim_stats.store++;
+    } else {
+      uint32_t rs1 = (insn >> 7) & 0x1f, rs2 = (insn >> 2) & 0x1f;
+      if (rs2 != 0)
+        sim_stats.alu++;                        /* c.mv, c.add */
+      else if (rs1 != 0)
+        sim_stats.jump++;                       /* c.jr, c.jalr */
+      else
+        sim_stats.other++;                      /* c.ebreak */
+    }
+    break;
+  }
+}
+
+void stats_count(uint64_t pc, uint64_t next_pc, uint64_t insn)
+{
+  uint32_t i = (uint32_t)insn;
+
+  sim_stats.instructions++;
+  if ((i & 0x3) != 0x3) {
+    count_compressed(pc, next_pc, i & 0xffff);
+    return;
+  }
+
+  uint32_t funct3 = (i >> 12) & 0x7;
+  switch (i & 0x7f) {
+  case 0x03: /* LOAD */
+    sim_stats.load++;
+    break;
+  case 0x23: /* STORE */
+    sim_stats.store++;
+    break;
+  case 0x07: /* LOAD-FP, los anchos 0, 5, 6 y 7 son de vectores */
+    if (funct3 >= 1 && funct3 <= 4)
+      sim_stats.load++;
+    else
+      sim_stats.vector++;
+    break;
+  case 0x27: /* STORE-FP */
+    if (funct3 >= 1 && funct3 <= 4)
+      sim_stats.store++;
+    else
+      sim_stats.vector++;
+    break;
+  case 0x13: case 0x1b: case 0x33: case 0x3b: case 0x37: case 0x17:
+    sim_stats.alu++;
+    break;
+  case 0x63: /* BRANCH */
+    count_branch(pc, next_pc, 4);
+    break;
+  case 0x6f: case 0x67: /* JAL, JALR */
+    sim_stats.jump++;
+    break;
+  case 0x2f: /* AMO: lr, sc y amo* */
+    switch (i >> 27) {
+    case 0x02: sim_stats.load++; break;
+    case 0x03: sim_stats.store++; break;
+    default:   sim_stats.amo++; break;
+    }
+    break;
+  case 0x43: case 0x47: case 0x4b: case 0x4f: case 0x53:
+    sim_stats.fp++;
+    break;
+  case 0x57: /* OP-V */
+    sim_stats.vector++;
+    break;
+  case 0x73: /* SYSTEM */
+    if (funct3 != 0 && funct3 != 4)
+      sim_stats.csr++;
+    else if (i == 0x00000073)
+      sim_stats.ecall++;
+    else
+      sim_stats.other++;
+    break;
+  default:
+    sim_stats.other++;
+    break;
+  }
+}
+
+void stats_reset(void)
+{
+  memset(&sim_stats, 0, sizeof(sim_stats));
+}
+
+void stats_print(FILE *f)
+{
+  fprintf(f, "ALU:              %" PRIu64 "\n", sim_stats.alu);
+  fprintf(f, "Branches:         %" PRIu64 " taken, %" PRIu64 " not taken\n",
+          sim_stats.branch_taken, sim_stats.branch_not_taken);
+  fprintf(f, "Jumps:            %" PRIu64 "\n", sim_stats.jump);
+  fprintf(f, "Loads/stores:     %" PRIu64 "/%" PRIu64 " (%" PRIu64 " amo)\n",
+          sim_stats.load, sim_stats.store, sim_stats.amo);
+  fprintf(f, "FP/vector:        %" PRIu64 "/%" PRIu64 "\n", sim_stats.fp,
+          sim_stats.vector);
+  fprintf(f, "CSR/ecall/other:  %" PRIu64 "/%" PRIu64 "/%" PRIu64 "\n",
+          sim_stats.csr, sim_stats.ecall, sim_stats.other);
+
+  for (int c = 0; c < SIM_CACHE_COUNT; c++) {
+    struct sim_cache_stats *s = &sim_stats.cache[c];
+    uint64_t lookups = s->hits + s->misses;
+    if (lookups == 0)
+      continue;
+    fprintf(f, "Cache %-4s        %" PRIu64 "/%" PRIu64 " hits (%.2f%%), %" PRIu64
+            " evictions\n", cache_names[c], s->hits, lookups,
+            100.0 * s->hits / lookups, s->evictions);
+  }
+
+  if (sim_stats.cycles && sim_stats.instructions) {
+    fprintf(f, "Cycles:           %" PRIu64 " (CPI %.3f)\n", sim_stats.cycles,
+            (double)sim_stats.cycles / sim_stats.instructions);
+    fprintf(f, "Stalls:           %" PRIu64 " data, %" PRIu64 " control, %" PRIu64
+            " memory\n", sim_stats.stall_data, sim_stats.stall_control,
+            sim_stats.stall_memory);
+  }
+
+  uint64_t predicted = sim_stats.bpred_branches + sim_stats.bpred_jumps;
+  if (predicted) {
+    uint64_t miss = sim_stats.bpred_dir_miss + sim_stats.bpred_target_miss;
+    fprintf(f, "Branch predictor: %" PRIu64 "/%" PRIu64 " correct (%.2f%%), %" PRIu64
+            " direction and %" PRIu64 " target mispredictions\n",
+            predicted - miss, predicted, 100.0 * (predicted - miss) / predicted,
+            sim_stats.bpred_dir_miss, sim_stats.bpred_target_miss);
+    if (sim_stats.btb_hits + sim_stats.btb_misses)
+      fprintf(f, "BTB hits:         %" PRIu64 "/%" PRIu64 "\n", sim_stats.btb_hits,
+              sim_stats.btb_hits + sim_stats.btb_misses);
+  }
+}
+
+EMSCRIPTEN_KEEPALIVE uint32_t get_stats(struct sim_stats *out)
+{
+  if (out != NULL)
+    memcpy(out, &sim_stats, sizeof(sim_stats));
+  return sizeof(sim_stats);
+}
+
+unit cache_stat(uint8_t cache, bool hit)
+{
+  if (cache >= 1 && cache <= SIM_CACHE_COUNT) {
+    if (hit)
+      sim_stats.cache[cache - 1].hits++;
+    else
+      sim_stats.cache[cache - 1].misses++;
+    timing_cache(cache, hit);
+  }
+  return UNIT;
+}
+
+unit cache_evict_stat(uint8_t cache)
+{
+  if (cache >= 1 && cache <= SIM_CACHE_COUNT)
+    sim_stats.cache[cache - 1].evictions++;
+  return UNIT;
+}
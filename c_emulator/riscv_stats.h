@@ -0,0 +1,76 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "sail.h"
+
+/* Execution counters for the IDE and the autograder.
+
+   Every retired instruction is counted in one class from its encoding, and
+   every lookup of the cache model as a hit or a miss of the level it looked
+   at; a replaced line counts as an eviction. get_stats() copies everything
+   in one call and can be called from the host between steps, while the
+   simulator is paused waiting for input or after it halts.
+
+   The layout only has uint64_t fields so the host can read it as a
+   BigUint64Array over HEAPU8. New fields are only added at the end. */
+
+/* Same numbering as cache_sizes()/set_config() in riscv_platform.c, minus 1 */
+enum sim_cache_id {
+  SIM_CACHE_L1,
+  SIM_CACHE_L1_I,
+  SIM_CACHE_L1_D,
+  SIM_CACHE_L2,
+  SIM_CACHE_L2_I,
+  SIM_CACHE_L2_D,
+  SIM_CACHE_COUNT
+};
+
+struct sim_cache_stats {
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t evictions;
+};
+
+struct sim_stats {
+  uint64_t instructions;
+  uint64_t alu;           /* integer, M and B arithmetic, lui/auipc */
+  uint64_t branch_taken;
+  uint64_t branch_not_taken;
+  uint64_t jump;          /* jal, jalr, c.j, c.jr, c.jal, c.jalr */
+  uint64_t load;          /* integer and FP loads, lr */
+  uint64_t store;         /* integer and FP stores, sc */
+  uint64_t amo;
+  uint64_t fp;            /* FP arithmetic, conversions and moves */
+  uint64_t vector;        /* OP-V and vector loads/stores */
+  uint64_t csr;
+  uint64_t ecall;
+  uint64_t other;         /* fence, ebreak, xret, wfi, sfence.vma... */
+  struct sim_cache_stats cache[SIM_CACHE_COUNT];
+  /* Timing model (--timing, riscv_timing.h), 0 without it */
+  uint64_t cycles;
+  uint64_t stall_data;
+  uint64_t stall_control;
+  uint64_t stall_memory;
+  /* Branch predictor (--branch-predictor, riscv_bpred.h) */
+  uint64_t bpred_branches;     /* conditional branches */
+  uint64_t bpred_dir_miss;     /* wrong direction */
+  uint64_t bpred_jumps;        /* jal and jalr */
+  uint64_t bpred_target_miss;  /* taken with a wrong or unknown target */
+  uint64_t btb_hits;
+  uint64_t btb_misses;
+};
+
+extern struct sim_stats sim_stats;
+
+void stats_count(uint64_t pc, uint64_t next_pc, uint64_t insn);
+void stats_reset(void);
+void stats_print(FILE *f);
+
+/* Host side: copies the counters to out (if not NULL), returns sizeof */
+uint32_t get_stats(struct sim_stats *out);
+
+/* Sail externs, called from read_cache() and replace_cache() in
+   riscv_mem.sail with the 1-based cache number */
+unit cache_stat(uint8_t cache, bool hit);
+unit cache_evict_stat(uint8_t cache);
@@ -0,0 +1,411 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "riscv_sweep.h"
+
+/* Cache sweep, see riscv_sweep.h */
+
+#define SWEEP_MAX_CONFIGS 256
+#define SWEEP_MAX_VALUES 32
+#define SWEEP_MAX_STACKS 8
+
+enum sweep_policy { SWEEP_LRU, SWEEP_FIFO, SWEEP_RANDOM };
+static const char *policy_names[] = { "lru", "fifo", "random" };
+
+struct sweep_cache {
+  uint64_t size, line, assoc, sets;
+  enum sweep_policy policy;
+  uint64_t *tags;   /* linea + 1, 0 es una via vacia */
+  uint64_t *stamps; /* ultimo uso (LRU) o llegada (FIFO) */
+  uint64_t hits, misses, evictions;
+};
+
+/* Distancias de pila LRU (Mattson) con un arbol de Fenwick sobre el tiempo
+   del ultimo acceso de cada linea: la distancia es el numero de lineas
+   distintas accedidas desde el anterior acceso a la misma. */
+struct sweep_stack {
+  uint64_t line;
+  uint64_t *keys;     /* tabla hash linea + 1 -> tiempo */
+  uint64_t *times;
+  uint64_t slots, used;
+  uint32_t *fenwick;
+  uint64_t now, cap;
+  uint64_t cold;
+  uint64_t hist[66];  /* 0: distancia 0, b: distancias [2^(b-1), 2^b) */
+};
+
+bool sweep_enabled = false;
+
+static struct sweep_cache caches[SWEEP_MAX_CONFIGS];
+static int num_caches = 0;
+static struct sweep_stack stacks[SWEEP_MAX_STACKS];
+static int num_stacks = 0;
+static bool want[3];
+static uint64_t refs = 0;
+static uint64_t ref_clock = 0;
+static uint64_t rng = 0x9e3779b97f4a7c15;
+
+static void *sweep_calloc(size_t n, size_t size)
+{
+  void *p = calloc(n, size);
+  if (p == NULL) {
+    fprintf(stderr, "Cannot allocate %zu bytes for the cache sweep\n", n * size);
+    exit(1);
+  }
+  return p;
+}
+
+/* ---- caches asociativas por conjuntos ---- */
+
+static bool cache_access(struct sweep_cache *c, uint64_t line)
+{
+  uint64_t *tags = &c->tags[(line % c->sets) * c->assoc];
+  uint64_t *stamps = &c->stamps[(line % c->sets) * c->assoc];
+  uint64_t victim = 0;
+
+  for (uint64_t w = 0; w < c->assoc; w++) {
+    if (tags[w] == line + 1) {
+      c->hits++;
+      if (c->policy == SWEEP_LRU)
+        stamps[w] = ref_clock;
+      return true;
+    }
+    if (tags[w] == 0 || (tags[victim] != 0 && stamps[w] < stamps[victim]))
+      victim = w;
+  }
+
+  c->misses++;
+  if (tags[victim] != 0) {
+    c->evictions++;
+    if (c->policy == SWEEP_RANDOM) {
+      rng ^= rng << 13;
+      rng ^= rng >> 7;
+      rng ^= rng << 17;
+      victim = rng % c->assoc;
+    }
+  }
+  tags[victim] = line + 1;
+  stamps[victim] = ref_clock;
+  return false;
+}
+
+/* ---- distancias de pila ---- */
+
+static void fenwick_add(struct sweep_stack *s, uint64_t i, int32_t v)
+{
+  for (i++; i <= s->cap; i += i & -i)
+    s->fenwick[i - 1] += v;
+}
+
+static uint64_t fenwick_sum(struct sweep_stack *s, uint64_t i) /* [0, i) */
+{
+  uint64_t sum = 0;
+  for (; i > 0; i -= i & -i)
+    sum += s->fenwick[i - 1];
+  return sum;
+}
+
+static uint64_t *stack_slot(struct sweep_stack *s, uint64_t line)
+{
+  uint64_t h = (line * 0x9e3779b97f4a7c15) & (s->slots - 1);
+  while (s->keys[h] != 0 && s->keys[h] != line + 1)
+    h = (h + 1) & (s->slots - 1);
+  return &s->keys[h];
+}
+
+static void stack_grow(struct sweep_stack *s)
+{
+  uint64_t *keys = s->keys, *times = s->times, slots = s->slots;
+
+  s->slots = slots ? slots * 2 : 4096;
+  s->keys = sweep_calloc(s->slots, sizeof(uint64_t));
+  s->times = sweep_calloc(s->slots, sizeof(uint64_t));
+  for (uint64_t i = 0; i < slots; i++) {
+    if (keys[i] == 0)
+      continue;
+    uint64_t *k = stack_slot(s, keys[i] - 1);
+    *k = keys[i];
+    s->times[k - s->keys] = times[i];
+  }
+  free(keys);
+  free(times);
+}
+
+static int cmp_time(const void *a, const void *b)
+{
+  uint64_t x = **(uint64_t *const *)a, y = **(uint64_t *const *)b;
+  return x < y ? -1 : x > y;
+}
+
+/* Se acaba el arbol: se renumeran los tiempos de las lineas vivas en orden */
+static void stack_compact(struct sweep_stack *s)
+{
+  uint64_t **live = sweep_calloc(s->used ? s->used : 1, sizeof(uint64_t *));
+  uint64_t n = 0;
+  for (uint64_t i = 0; i < s->slots; i++)
+    if (s->keys[i] != 0)
+      live[n++] = &s->times[i];
+  qsort(live, n, sizeof(*live), cmp_time);
+  for (uint64_t i = 0; i < n; i++)
+    *live[i] = i;
+  free(live);
+
+  free(s->fenwick);
+  s->cap = n * 4 > 65536 ? n * 4 : 65536;
+  s->fenwick = sweep_calloc(s->cap, sizeof(uint32_t));
+  for (uint64_t i = 0; i < n; i++)
+    fenwick_add(s, i, 1);
+  s->now = n;
+}
+
+static void stack_access(struct sweep_stack *s, uint64_t line)
+{
+  if (s->used * 2 >= s->slots)
+    stack_grow(s);
+  if (s->now == s->cap)
+    stack_compact(s);
+
+  uint64_t *key = stack_slot(s, line);
+  uint64_t *time = &s->times[key - s->keys];
+  if (*key == 0) {
+    *key = line + 1;
+    s->used++;
+    s->cold++;
+  } else {
+    uint64_t d = fenwick_sum(s, s->now) - fenwick_sum(s, *time + 1);
+    int b = 0;
+    while (d >> b)
+      b++;
+    s->hist[b]++;
+    fenwick_add(s, *time, -1);
+  }
+  *time = s->now;
+  fenwick_add(s, s->now++, 1);
+}
+
+/* ---- referencias ---- */
+
+int sweep_access(enum sweep_ref kind, uint64_t paddr, uint64_t width)
+{
+  if (!want[kind] || width == 0)
+    return -1;
+  refs++;
+  ref_clock++;
+
+  bool first_hit = true;
+  for (int i = 0; i < num_caches; i++) {
+    struct sweep_cache *c = &caches[i];
+    bool hit = true;
+    for (uint64_t l = paddr / c->line; l <= (paddr + width - 1) / c->line; l++)
+      hit &= cache_access(c, l);
+    if (i == 0)
+      first_hit = hit;
+  }
+  for (int i = 0; i < num_stacks; i++) {
+    struct sweep_stack *s = &stacks[i];
+    for (uint64_t l = paddr / s->line; l <= (paddr + width - 1) / s->line; l++)
+      stack_access(s, l);
+  }
+  return num_caches ? first_hit : -1;
+}
+
+/* ---- configuracion ---- */
+
+static uint64_t parse_number(const char *key, const char *v)
+{
+  if (strcmp(key, "assoc") == 0 && strcmp(v, "full") == 0)
+    return 0;
+
+  char *end;
+  uint64_t n = strtoull(v, &end, 0);
+  if (*end == 'k' || *end == 'K')
+    n <<= 10, end++;
+  else if (*end == 'm' || *end == 'M')
+    n <<= 20, end++;
+  if (*v == '\0' || *end != '\0' || n == 0 || (n & (n - 1)) != 0) {
+    fprintf(stderr, "Invalid cache sweep value '%s=%s' (power of 2)\n", key, v);
+    exit(1);
+  }
+  return n;
+}
+
+/* "a..b" (potencias de 2) o "a+b+c" */
+static int parse_values(const char *key, char *v, uint64_t *out)
+{
+  int n = 0;
+  char *dots = strstr(v, "..");
+
+  if (dots != NULL) {
+    *dots = '\0';
+    uint64_t lo = parse_number(key, v), hi = parse_number(key, dots + 2);
+    for (uint64_t x = lo; x <= hi && n < SWEEP_MAX_VALUES; x *= 2)
+      out[n++] = x;
+  } else {
+    char *save = NULL;
+    for (char *p = strtok_r(v, "+", &save); p && n < SWEEP_MAX_VALUES; p = strtok_r(NULL, "+", &save)) {
+      if (strcmp(key, "policy") == 0) {
+        int k = 0;
+        while (k < 3 && strcmp(p, policy_names[k]) != 0)
+          k++;
+        if (k == 3) {
+          fprintf(stderr, "Unknown cache sweep policy '%s'\n", p);
+          exit(1);
+        }
+        out[n++] = k;
+      } else {
+        out[n++] = parse_number(key, p);
+      }
+    }
+  }
+  if (n == 0) {
+    fprintf(stderr, "Empty cache sweep parameter '%s'\n", key);
+    exit(1);
+  }
+  return n;
+}
+
+void sweep_init(const char *spec)
+{
+  uint64_t sizes[SWEEP_MAX_VALUES], lines[SWEEP_MAX_VALUES] = { 32 };
+  uint64_t assocs[SWEEP_MAX_VALUES] = { 1 }, policies[SWEEP_MAX_VALUES] = { SWEEP_LRU };
+  uint64_t stack_lines[SWEEP_MAX_VALUES];
+  int n_sizes = 0, n_lines = 1, n_assocs = 1, n_policies = 1, n_stacks = 0;
+  char *copy = strdup(spec), *save = NULL;
+
+  want[SWEEP_LOAD] = want[SWEEP_STORE] = true;
+  for (char *p = strtok_r(copy, ",", &save); p; p = strtok_r(NULL, ",", &save)) {
+    char *eq = strchr(p, '=');
+    if (eq == NULL) {
+      fprintf(stderr, "Invalid cache sweep parameter '%s'\n", p);
+      exit(1);
+    }
+    *eq = '\0';
+    if (strcmp(p, "size") == 0) {
+      n_sizes = parse_values(p, eq + 1, sizes);
+    } else if (strcmp(p, "line") == 0) {
+      n_lines = parse_values(p, eq + 1, lines);
+    } else if (strcmp(p, "assoc") == 0) {
+      n_assocs = parse_values(p, eq + 1, assocs);
+    } else if (strcmp(p, "policy") == 0) {
+      n_policies = parse_values(p, eq + 1, policies);
+    } else if (strcmp(p, "stack") == 0) {
+      n_stacks = parse_values(p, eq + 1, stack_lines);
+    } else if (strcmp(p, "type") == 0 && strlen(eq + 1) == 1 && strchr("iud", eq[1])) {
+      want[SWEEP_FETCH] = eq[1] != 'd';
+      want[SWEEP_LOAD] = want[SWEEP_STORE] = eq[1] != 'i';
+    } else {
+      fprintf(stderr, "Unknown cache sweep parameter '%s=%s'\n", p, eq + 1);
+      exit(1);
+    }
+  }
+  free(copy);
+
+  if (n_sizes == 0 && n_stacks == 0) {
+    fprintf(stderr, "The cache sweep needs size=... or stack=...\n");
+    exit(1);
+  }
+
+  for (int s = 0; s < n_sizes; s++)
+    for (int l = 0; l < n_lines; l++)
+      for (int a = 0; a < n_assocs; a++)
+        for (int p = 0; p < n_policies; p++) {
+          uint64_t assoc = assocs[a] ? assocs[a] : sizes[s] / lines[l];
+          if (sizes[s] < lines[l] * assoc)
+            continue; /* no cabe ni un conjunto */
+          if (num_caches == SWEEP_MAX_CONFIGS) {
+            fprintf(stderr, "Too many cache sweep configurations (max %d)\n", SWEEP_MAX_CONFIGS);
+            exit(1);
+          }
+          struct sweep_cache *c = &caches[num_caches++];
+          c->size = sizes[s];
+          c->line = lines[l];
+          c->assoc = assoc;
+          c->sets = sizes[s] / (lines[l] * assoc);
+          c->policy = policies[p];
+          c->tags = sweep_calloc(c->sets * assoc, sizeof(uint64_t));
+          c->stamps = sweep_calloc(c->sets * assoc, sizeof(uint64_t));
+        }
+
+  for (int i = 0; i < n_stacks && i < SWEEP_MAX_STACKS; i++) {
+    stacks[i].line = stack_lines[i];
+    stacks[i].cap = 65536;
+    stacks[i].fenwick = sweep_calloc(stacks[i].cap, sizeof(uint32_t));
+    num_stacks++;
+  }
+  sweep_enabled = true;
+}
+
+/* ---- resultados ---- */
+
+void sweep_write(const char *csv_file)
+{
+  if (!sweep_enabled)
+    return;
+
+  FILE *csv = NULL;
+  if (csv_file != NULL && (csv = fopen(csv_file, "w")) == NULL)
+    fprintf(stderr, "Cannot open cache sweep file '%s'\n", csv_file);
+  if (csv)
+    fprintf(csv, "size,line,assoc,policy,accesses,hits,misses,evictions,miss_ratio\n");
+
+  fprintf(stderr, "Cache sweep: %" PRIu64 " references\n", refs);
+  fprintf(stderr, "  %8s %5s %6s %-7s %12s %12s %8s\n", "size", "line", "assoc",
+          "policy", "accesses", "misses", "miss%");
+  for (int i = 0; i < num_caches; i++) {
+    struct sweep_cache *c = &caches[i];
+    uint64_t accesses = c->hits + c->misses;
+    double ratio = accesses ? (double)c->misses / accesses : 0.0;
+    fprintf(stderr, "  %8" PRIu64 " %5" PRIu64 " %6" PRIu64 " %-7s %12" PRIu64 " %12" PRIu64
+            " %7.2f%%\n", c->size, c->line, c->assoc, policy_names[c->policy], accesses,
+            c->misses, 100.0 * ratio);
+    if (csv)
+      fprintf(csv, "%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%s,%" PRIu64 ",%" PRIu64 ",%" PRIu64
+              ",%" PRIu64 ",%.6f\n", c->size, c->line, c->assoc, policy_names[c->policy],
+              accesses, c->hits, c->misses, c->evictions, ratio);
+  }
+
+  /* Tamanos de 1 linea hasta que caben todas las lineas distintas */
+  for (int i = 0; i < num_stacks; i++) {
+    struct sweep_stack *s = &stacks[i];
+    uint64_t accesses = s->cold, hits = 0;
+    for (int b = 0; b < 66; b++)
+      accesses += s->hist[b];
+    fprintf(stderr, "  LRU stack distances, %" PRIu64 "-byte lines, fully associative:\n", s->line);
+    for (int k = 0; k < 64 && accesses; k++) {
+      hits += s->hist[k];
+      uint64_t size = s->line << k;
+      double ratio = (double)(accesses - hits) / accesses;
+      fprintf(stderr, "  %8" PRIu64 " %5" PRIu64 " %6s %-7s %12" PRIu64 " %12" PRIu64
+              " %7.2f%%\n", size, s->line, "full", "lru", accesses, accesses - hits,
+              100.0 * ratio);
+      if (csv)
+        fprintf(csv, "%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",lru,%" PRIu64 ",%" PRIu64 ",%" PRIu64
+                ",,%.6f\n", size, s->line, UINT64_C(1) << k, accesses, hits, accesses - hits,
+                ratio);
+      if ((UINT64_C(1) << k) >= s->used)
+        break;
+    }
+  }
+  if (csv)
+    fclose(csv);
+}
+
+void sweep_reset(void)
+{
+  for (int i = 0; i < num_caches; i++) {
+    free(caches[i].tags);
+    free(caches[i].stamps);
+  }
+  for (int i = 0; i < num_stacks; i++) {
+    free(stacks[i].keys);
+    free(stacks[i].times);
+    free(stacks[i].fenwick);
+  }
+  memset(caches, 0, sizeof(caches));
+  memset(stacks, 0, sizeof(stacks));
+  num_caches = num_stacks = 0;
+  refs = ref_clock = 0;
+  want[SWEEP_FETCH] = want[SWEEP_LOAD] = want[SWEEP_STORE] = false;
+  sweep_enabled = false;
+}
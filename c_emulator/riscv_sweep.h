@@ -0,0 +1,37 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Cache sweep (--cache-sweep <spec>): simulates many cache geometries in
+   the same run instead of one run per configuration.
+
+   Every physical memory reference of the program (mem_ref() from
+   phys_mem_read/phys_mem_write) is fed to N independent set-associative
+   caches, one for each combination of the values in <spec>:
+     size=1k..64k      powers of 2 from 1k to 64k (k and m suffixes)
+     line=16+32        a list of values
+     assoc=1..8        ways, "full" for fully associative
+     policy=lru+fifo+random
+     type=d            references: d (loads/stores), i (fetches) or u (all)
+     stack=32          also an LRU stack-distance pass with 32-byte lines,
+                       which gives the fully associative LRU miss ratio of
+                       every size at once
+   e.g. --cache-sweep size=1k..16k,line=16+32,assoc=1+2+4,policy=lru
+   Defaults: line=32, assoc=1, policy=lru, type=d. The table is printed to
+   stderr at the end, and written as CSV with --cache-sweep-out <file>. */
+
+enum sweep_ref {
+  SWEEP_FETCH,
+  SWEEP_LOAD,
+  SWEEP_STORE
+};
+
+extern bool sweep_enabled;
+
+void sweep_init(const char *spec);
+void sweep_write(const char *csv_file);
+void sweep_reset(void);
+
+/* Returns 1 if the first configuration hit every line of the reference,
+   0 if it missed and -1 if the reference is not simulated */
+int sweep_access(enum sweep_ref kind, uint64_t paddr, uint64_t width);
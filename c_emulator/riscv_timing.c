@@ -0,0 +1,326 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "riscv_timing.h"
+#include "riscv_stats.h"
+#include "riscv_bpred.h"
+
+/* Timing model of a 5-stage in-order pipeline, see riscv_timing.h */
+
+#define TIMING_DEFAULTS { true, 1, 2, 1, 10, 50 }
+#define PIPELINE_FILL 4 /* IF, ID, EX y MEM antes del primer WB */
+
+bool timing_enabled = false;
+struct timing_config timing_config = TIMING_DEFAULTS;
+
+enum { CTL_NONE, CTL_BRANCH, CTL_JUMP };
+
+/* Registros que lee y escribe una instruccion: 0 es ninguno (o x0),
+   1-31 los enteros y 32-63 los de coma flotante */
+struct operands {
+  uint8_t rd, rs1, rs2, rs3;
+  bool load;
+  uint8_t ctl;
+};
+
+static uint64_t now;         /* ciclo en el que la ultima instruccion paso por ID */
+static uint64_t ready[64];   /* primer ciclo en el que ID puede leer cada registro */
+static uint64_t mem_stall;   /* fallos de cache de la instruccion en curso */
+static uint32_t ctl_penalty; /* salto tomado por la instruccion anterior */
+static bool started;
+
+static inline uint8_t xreg(uint32_t r) { return r & 0x1f; }
+static inline uint8_t freg(uint32_t r) { return 32 + (r & 0x1f); }
+static inline uint8_t creg(uint32_t r) { return 8 + (r & 0x7); } /* rd', rs1', rs2' */
+
+static void decode_compressed(uint32_t insn, struct operands *op)
+{
+  uint32_t funct3 = (insn >> 13) & 0x7;
+  uint32_t r9 = (insn >> 7) & 0x7, r4 = (insn >> 2) & 0x7;
+  uint32_t r11 = (insn >> 7) & 0x1f, r6 = (insn >> 2) & 0x1f;
+
+  switch (insn & 0x3) {
+  case 0:
+    switch (funct3) {
+    case 0: op->rd = creg(r4); op->rs1 = 2; break;          /* c.addi4spn */
+    case 1: op->rd = freg(creg(r4)); op->rs1 = creg(r9); op->load = true; break;
+    case 2: op->rd = creg(r4); op->rs1 = creg(r9); op->load = true; break;
+#ifdef RV32
+    case 3: op->rd = freg(creg(r4)); op->rs1 = creg(r9); op->load = true; break;
+#else
+    case 3: op->rd = creg(r4); op->rs1 = creg(r9); op->load = true; break;
+#endif
+    case 4:                                                  /* Zcb */
+      op->rs1 = creg(r9);
+      if ((insn >> 11) & 1)
+        op->rs2 = creg(r4);
+      else {
+        op->rd = creg(r4);
+        op->load = true;
+      }
+      break;
+    case 5: op->rs1 = creg(r9); op->rs2 = freg(creg(r4)); break;
+    case 6: op->rs1 = creg(r9); op->rs2 = creg(r4); break;
+#ifdef RV32
+    case 7: op->rs1 = creg(r9); op->rs2 = freg(creg(r4)); break;
+#else
+    case 7: op->rs1 = creg(r9); op->rs2 = creg(r4); break;
+#endif
+    }
+    break;
+  case 1:
+    switch (funct3) {
+#ifdef RV32
+    case 1: op->rd = 1; op->ctl = CTL_JUMP; break;           /* c.jal */
+    case 0: op->rd = op->rs1 = xreg(r11); break;            /* c.addi */
+#else
+    case 0: case 1: op->rd = op->rs1 = xreg(r11); break;    /* c.addi, c.addiw */
+#endif
+    case 2: op->rd = xreg(r11); break;                       /* c.li */
+    case 3:                                                  /* c.lui, c.addi16sp */
+      op->rd = xreg(r11);
+      if (r11 == 2)
+        op->rs1 = 2;
+      break;
+    case 4:
+      op->rd = op->rs1 = creg(r9);
+      if (((insn >> 10) & 0x3) == 0x3 && ((insn >> 12) & 1) == 0)
+        op->rs2 = creg(r4);
+      break;
+    case 5: op->ctl = CTL_JUMP; break;                       /* c.j */
+    default: op->rs1 = creg(r9); op->ctl = CTL_BRANCH; break;
+    }
+    break;
+  case 2:
+    switch (funct3) {
+    case 0: op->rd = op->rs1 = xreg(r11); break;            /* c.slli */
+    case 1: op->rd = freg(r11); op->rs1 = 2; op->load = true; break;
+    case 2: op->rd = xreg(r11); op->rs1 = 2; op->load = true; break;
+#ifdef RV32
+    case 3: op->rd = freg(r11); op->rs1 = 2; op->load = true; break;
+#else
+    case 3: op->rd = xreg(r11); op->rs1 = 2; op->load = true; break;
+#endif
+    case 4:
+      if (r6 != 0) {                                         /* c.mv, c.add */
+        op->rd = xreg(r11);
+        op->rs2 = xreg(r6);
+        if ((insn >> 12) & 1)
+          op->rs1 = xreg(r11);
+      } else if (r11 != 0) {                                 /* c.jr, c.jalr */
+        op->rs1 = xreg(r11);
+        op->rd = ((insn >> 12) & 1) ? 1 : 0;
+        op->ctl = CTL_BRANCH;
+      }
+      break;
+    case 5: op->rs1 = 2; op->rs2 = freg(r6); break;
+    case 6: op->rs1 = 2; op->rs2 = xreg(r6); break;
+#ifdef RV32
+    case 7: op->rs1 = 2; op->rs2 = freg(r6); break;
+#else
+    case 7: op->rs1 = 2; op->rs2 = xreg(r6); break;
+#endif
+    }
+    break;
+  }
+}
+
+static void decode(uint32_t insn, struct operands *op)
+{
+  memset(op, 0, sizeof(*op));
+  if ((insn & 0x3) != 0x3) {
+    decode_compressed(insn & 0xffff, op);
+    return;
+  }
+
+  uint32_t rd = (insn >> 7) & 0x1f, rs1 = (insn >> 15) & 0x1f;
+  uint32_t rs2 = (insn >> 20) & 0x1f, rs3 = insn >> 27;
+  uint32_t funct3 = (insn >> 12) & 0x7;
+
+  switch (insn & 0x7f) {
+  case 0x03: op->rd = xreg(rd); op->rs1 = xreg(rs1); op->load = true; break;
+  case 0x23: op->rs1 = xreg(rs1); op->rs2 = xreg(rs2); break;
+  case 0x07: /* los vectores no se modelan, solo la direccion base */
+    op->rs1 = xreg(rs1);
+    if (funct3 >= 1 && funct3 <= 4) {
+      op->rd = freg(rd);
+      op->load = true;
+    }
+    break;
+  case 0x27:
+    op->rs1 = xreg(rs1);
+    if (funct3 >= 1 && funct3 <= 4)
+      op->rs2 = freg(rs2);
+    break;
+  case 0x13: case 0x1b: op->rd = xreg(rd); op->rs1 = xreg(rs1); break;
+  case 0x33: case 0x3b:
+    op->rd = xreg(rd); op->rs1 = xreg(rs1); op->rs2 = xreg(rs2);
+    break;
+  case 0x37: case 0x17: op->rd = xreg(rd); break;
+  case 0x63: op->rs1 = xreg(rs1); op->rs2 = xreg(rs2); op->ctl = CTL_BRANCH; break;
+  case 0x6f: op->rd = xreg(rd); op->ctl = CTL_JUMP; break;
+  case 0x67: op->rd = xreg(rd); op->rs1 = xreg(rs1); op->ctl = CTL_BRANCH; break;
+  case 0x2f:
+    op->rd = xreg(rd); op->rs1 = xreg(rs1); op->rs2 = xreg(rs2); op->load = true;
+    break;
+  case 0x43: case 0x47: case 0x4b: case 0x4f:
+    op->rd = freg(rd); op->rs1 = freg(rs1); op->rs2 = freg(rs2); op->rs3 = freg(rs3);
+    break;
+  case 0x53:
+    switch (insn >> 27) {
+    case 0x14: op->rd = xreg(rd); op->rs1 = freg(rs1); op->rs2 = freg(rs2); break;
+    case 0x18: case 0x1c: op->rd = xreg(rd); op->rs1 = freg(rs1); break;
+    case 0x1a: case 0x1e: op->rd = freg(rd); op->rs1 = xreg(rs1); break;
+    case 0x08: case 0x0b: op->rd = freg(rd); op->rs1 = freg(rs1); break;
+    default: op->rd = freg(rd); op->rs1 = freg(rs1); op->rs2 = freg(rs2); break;
+    }
+    break;
+  case 0x57: /* OP-V: solo los operandos escalares */
+    if (funct3 == 7) {
+      op->rd = xreg(rd);
+      if ((insn >> 30) != 0x3)
+        op->rs1 = xreg(rs1);
+      if ((insn >> 25) == 0x40)
+        op->rs2 = xreg(rs2);
+    } else if (funct3 == 4 || funct3 == 6) {
+      op->rs1 = xreg(rs1);
+    } else if (funct3 == 5) {
+      op->rs1 = freg(rs1);
+    } else if (funct3 == 2 && (insn >> 26) == 0x10) {
+      op->rd = xreg(rd);                                     /* vmv.x.s, vcpop... */
+    }
+    break;
+  case 0x73:
+    if (funct3 != 0 && funct3 != 4) {
+      op->rd = xreg(rd);
+      if (funct3 < 4)
+        op->rs1 = xreg(rs1);
+    }
+    break;
+  }
+}
+
+static inline uint64_t max64(uint64_t a, uint64_t b) { return a > b ? a : b; }
+
+uint64_t timing_count(uint64_t pc, uint64_t next_pc, uint64_t insn)
+{
+  struct operands op;
+  decode((uint32_t)insn, &op);
+
+  /* ID de esta instruccion: un ciclo despues de la anterior, mas las
+     burbujas del salto anterior y la espera por los operandos */
+  uint64_t t = now + 1 + ctl_penalty;
+  sim_stats.stall_control += ctl_penalty;
+
+  uint64_t dep = max64(max64(ready[op.rs1], ready[op.rs2]), ready[op.rs3]);
+  if (dep > t) {
+    sim_stats.stall_data += dep - t;
+    t = dep;
+  }
+
+  t += mem_stall;
+  sim_stats.stall_memory += mem_stall;
+  mem_stall = 0;
+
+  if (op.rd != 0) {
+    if (!timing_config.forwarding)
+      ready[op.rd] = t + 3;
+    else
+      ready[op.rd] = t + 1 + (op.load ? timing_config.load_use : 0);
+  }
+
+  /* Con el predictor de saltos solo cuestan los fallos de prediccion */
+  uint64_t len = (insn & 0x3) == 0x3 ? 4 : 2;
+  if (bpred_enabled && op.ctl != CTL_NONE) {
+    ctl_penalty = !bpred_miss ? 0
+        : op.ctl == CTL_JUMP ? timing_config.jump : timing_config.branch;
+    bpred_miss = false;
+  } else if (next_pc != pc + len)
+    ctl_penalty = op.ctl == CTL_JUMP ? timing_config.jump : timing_config.branch;
+  else
+    ctl_penalty = 0;
+
+  uint64_t cycles = t - now;
+  if (!started) {
+    cycles += PIPELINE_FILL;
+    started = true;
+  }
+  now = t;
+  sim_stats.cycles += cycles;
+  return cycles;
+}
+
+void timing_cache(uint8_t cache, bool hit)
+{
+  if (!timing_enabled || hit)
+    return;
+  /* 1-3 son L1, L1_I y L1_D; 4-6 las de L2 */
+  mem_stall += cache <= 3 ? timing_config.l1_miss : timing_config.l2_miss;
+}
+
+static void parse_param(const char *param)
+{
+  static const struct {
+    const char *name;
+    size_t offset;
+  } params[] = {
+    {"load_use", offsetof(struct timing_config, load_use)},
+    {"branch",   offsetof(struct timing_config, branch)  },
+    {"jump",     offsetof(struct timing_config, jump)    },
+    {"l1_miss",  offsetof(struct timing_config, l1_miss) },
+    {"l2_miss",  offsetof(struct timing_config, l2_miss) },
+  };
+
+  const char *eq = strchr(param, '=');
+  char *end;
+  unsigned long value = eq ? strtoul(eq + 1, &end, 0) : 0;
+  if (eq == NULL || eq[1] == '\0' || *end != '\0' || value > 10000) {
+    fprintf(stderr, "Invalid timing parameter '%s'\n", param);
+    exit(1);
+  }
+
+  size_t len = eq - param;
+  if (len == strlen("forwarding") && strncmp(param, "forwarding", len) == 0) {
+    timing_config.forwarding = value != 0;
+    return;
+  }
+  for (size_t i = 0; i < sizeof(params) / sizeof(params[0]); i++) {
+    if (strlen(params[i].name) == len && strncmp(param, params[i].name, len) == 0) {
+      *(uint32_t *)((char *)&timing_config + params[i].offset) = value;
+      return;
+    }
+  }
+  fprintf(stderr, "Unknown timing parameter '%s'\n", param);
+  exit(1);
+}
+
+void timing_init(const char *spec)
+{
+  timing_enabled = true;
+  if (spec == NULL)
+    return;
+
+  char *copy = strdup(spec), *save = NULL;
+  for (char *p = strtok_r(copy, ",", &save); p; p = strtok_r(NULL, ",", &save))
+    parse_param(p);
+  free(copy);
+}
+
+void timing_clear(void)
+{
+  now = 0;
+  memset(ready, 0, sizeof(ready));
+  mem_stall = 0;
+  ctl_penalty = 0;
+  started = false;
+}
+
+void timing_reset(void)
+{
+  struct timing_config defaults = TIMING_DEFAULTS;
+
+  timing_enabled = false;
+  timing_config = defaults;
+  timing_clear();
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Timing model of a classic 5-stage in-order pipeline (--timing).
+
+   It runs on the stream of retired instructions, after the functional
+   model, and only estimates how many cycles each one takes:
+   - data hazards: with forwarding only the load-use case stalls, without
+     it a register can be read in ID once the producer has reached WB;
+   - control hazards: fetch is predict-not-taken, so taken branches and
+     jalr (and traps and xret) cost the branch penalty and jal the jump
+     penalty; with --branch-predictor only its mispredictions do;
+   - memory: every miss of the cache model (riscv_mem.sail) stalls the
+     pipeline for the latency of the next level.
+
+   The cycles go to mcycle (unless inhibited in mcountinhibit) and to the
+   counters of riscv_stats.h. Parameters, comma separated:
+     forwarding=0|1  load_use=N  branch=N  jump=N  l1_miss=N  l2_miss=N */
+
+struct timing_config {
+  bool forwarding;
+  uint32_t load_use;  /* stall cycles of a load followed by a use */
+  uint32_t branch;    /* taken branch, jalr, trap */
+  uint32_t jump;      /* jal, c.j, c.jal */
+  uint32_t l1_miss;   /* miss in L1, served by L2 or memory */
+  uint32_t l2_miss;   /* miss in L2, served by memory */
+};
+
+extern bool timing_enabled;
+extern struct timing_config timing_config;
+
+void timing_init(const char *spec);
+void timing_reset(void);
+/* Only the pipeline state, between --batch jobs: keeps --timing */
+void timing_clear(void);
+
+/* Called from run_sail() for each retired instruction, returns its cycles */
+uint64_t timing_count(uint64_t pc, uint64_t next_pc, uint64_t insn);
+
+/* Called from cache_stat() on every lookup of the cache model */
+void timing_cache(uint8_t cache, bool hit);
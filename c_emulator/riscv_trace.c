@@ -0,0 +1,296 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#include "riscv_trace.h"
+#include "riscv_stats.h"
+#include "riscv_sweep.h"
+#include "riscv_timing.h"
+
+/* Memory reference traces, see riscv_trace.h */
+
+#define TRACE_MAGIC "CRMT"
+#define TRACE_VERSION 1
+#define TRACE_BLOCK (64 * 1024)
+#define TRACE_MAX_RECORD 32     /* cabecera + 3 varints + instruccion */
+#define TRACE_WIDTH_ESCAPE 7
+#define TRACE_PC_CHANGED 0x20
+
+/* Estado comun al escritor y al lector para los deltas */
+struct trace_state {
+  uint64_t last_pc;
+  uint64_t last_addr[3];
+};
+
+struct trace_reader {
+  FILE *f;
+  uint8_t *raw, *comp;
+  size_t pos, len;
+  struct trace_state st;
+};
+
+bool trace_enabled = false;
+
+static FILE *trace_file = NULL;
+static const char *trace_name = NULL;
+static uint8_t *raw = NULL, *comp = NULL;
+static size_t raw_len = 0;
+static struct trace_state wst;
+
+static inline uint64_t zigzag(uint64_t delta)
+{
+  return (delta << 1) ^ (uint64_t)((int64_t)delta >> 63);
+}
+
+static inline uint64_t unzigzag(uint64_t v)
+{
+  return (v >> 1) ^ -(v & 1);
+}
+
+static inline void put_varint(uint64_t v)
+{
+  while (v >= 0x80) {
+    raw[raw_len++] = (uint8_t)v | 0x80;
+    v >>= 7;
+  }
+  raw[raw_len++] = (uint8_t)v;
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+  for (int i = 0; i < 4; i++)
+    p[i] = v >> (8 * i);
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+  return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void flush_block(void)
+{
+  if (raw_len == 0)
+    return;
+
+  uLongf comp_len = compressBound(TRACE_BLOCK + TRACE_MAX_RECORD);
+  uint8_t head[8];
+  /* Nivel 1: la traza se escribe mientras se ejecuta */
+  if (compress2(comp, &comp_len, raw, raw_len, 1) != Z_OK) {
+    fprintf(stderr, "Cannot compress memory trace block\n");
+    exit(1);
+  }
+  put_u32(head, raw_len);
+  put_u32(head + 4, comp_len);
+  if (fwrite(head, 1, 8, trace_file) != 8
+      || fwrite(comp, 1, comp_len, trace_file) != comp_len) {
+    fprintf(stderr, "Cannot write memory trace '%s'\n", trace_name);
+    exit(1);
+  }
+  raw_len = 0;
+}
+
+void trace_start(const char *file, int xlen)
+{
+  trace_file = fopen(file, "wb");
+  if (trace_file == NULL) {
+    fprintf(stderr, "Cannot open memory trace '%s'\n", file);
+    exit(1);
+  }
+  raw = malloc(TRACE_BLOCK + TRACE_MAX_RECORD);
+  comp = malloc(compressBound(TRACE_BLOCK + TRACE_MAX_RECORD));
+  if (raw == NULL || comp == NULL) {
+    fprintf(stderr, "Cannot allocate memory trace buffers\n");
+    exit(1);
+  }
+
+  uint8_t head[8] = { 'C', 'R', 'M', 'T', TRACE_VERSION, (uint8_t)xlen, 0, 0 };
+  fwrite(head, 1, sizeof(head), trace_file);
+  trace_name = file;
+  raw_len = 0;
+  memset(&wst, 0, sizeof(wst));
+  trace_enabled = true;
+}
+
+void trace_stop(void)
+{
+  if (trace_file != NULL) {
+    flush_block();
+    fclose(trace_file);
+  }
+  free(raw);
+  free(comp);
+  raw = comp = NULL;
+  trace_file = NULL;
+  trace_enabled = false;
+}
+
+static inline void put_pc(uint8_t *head, uint64_t pc)
+{
+  if (pc != wst.last_pc) {
+    *head |= TRACE_PC_CHANGED;
+    put_varint(zigzag(pc - wst.last_pc));
+    wst.last_pc = pc;
+  }
+}
+
+void trace_mem(enum trace_type type, uint64_t pc, uint64_t addr, uint64_t width)
+{
+  uint8_t code = TRACE_WIDTH_ESCAPE;
+  if (width && width <= 16 && (width & (width - 1)) == 0)
+    code = __builtin_ctzll(width);
+
+  size_t head = raw_len++;
+  raw[head] = type | code << 2;
+  put_pc(&raw[head], pc);
+  put_varint(zigzag(addr - wst.last_addr[type]));
+  wst.last_addr[type] = addr;
+  if (code == TRACE_WIDTH_ESCAPE)
+    put_varint(width);
+
+  if (raw_len >= TRACE_BLOCK)
+    flush_block();
+}
+
+void trace_retire(uint64_t pc, uint32_t insn, uint64_t next_pc)
+{
+  uint64_t len = (insn & 0x3) == 0x3 ? 4 : 2;
+
+  size_t head = raw_len++;
+  raw[head] = TRACE_RETIRE | (len == 2) << 2;
+  put_pc(&raw[head], pc);
+  for (uint64_t i = 0; i < len; i++)
+    raw[raw_len++] = insn >> (8 * i);
+  /* Casi siempre 0: la siguiente instruccion */
+  put_varint(zigzag(next_pc - (pc + len)));
+  wst.last_pc = next_pc;
+
+  if (raw_len >= TRACE_BLOCK)
+    flush_block();
+}
+
+/* ---- lectura ---- */
+
+static void trace_corrupt(struct trace_reader *r)
+{
+  fprintf(stderr, "Corrupted memory trace\n");
+  exit(1);
+}
+
+struct trace_reader *trace_open(const char *file)
+{
+  struct trace_reader *r = calloc(1, sizeof(*r));
+  uint8_t head[8];
+
+  r->f = fopen(file, "rb");
+  if (r->f == NULL) {
+    fprintf(stderr, "Cannot open memory trace '%s'\n", file);
+    exit(1);
+  }
+  if (fread(head, 1, 8, r->f) != 8 || memcmp(head, TRACE_MAGIC, 4) != 0
+      || head[4] != TRACE_VERSION) {
+    fprintf(stderr, "'%s' is not a memory trace (version %d)\n", file, TRACE_VERSION);
+    exit(1);
+  }
+  r->raw = malloc(TRACE_BLOCK + TRACE_MAX_RECORD);
+  r->comp = malloc(compressBound(TRACE_BLOCK + TRACE_MAX_RECORD));
+  if (r->raw == NULL || r->comp == NULL) {
+    fprintf(stderr, "Cannot allocate memory trace buffers\n");
+    exit(1);
+  }
+  return r;
+}
+
+static bool read_block(struct trace_reader *r)
+{
+  uint8_t head[8];
+  size_t n = fread(head, 1, 8, r->f);
+  if (n == 0)
+    return false;
+
+  uLongf raw_size = get_u32(head);
+  uint32_t comp_size = get_u32(head + 4);
+  if (n != 8 || raw_size > TRACE_BLOCK + TRACE_MAX_RECORD
+      || comp_size > compressBound(TRACE_BLOCK + TRACE_MAX_RECORD)
+      || fread(r->comp, 1, comp_size, r->f) != comp_size
+      || uncompress(r->raw, &raw_size, r->comp, comp_size) != Z_OK)
+    trace_corrupt(r);
+  r->pos = 0;
+  r->len = raw_size;
+  return true;
+}
+
+static uint64_t get_varint(struct trace_reader *r)
+{
+  uint64_t v = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (r->pos >= r->len)
+      trace_corrupt(r);
+    uint8_t b = r->raw[r->pos++];
+    v |= (uint64_t)(b & 0x7f) << shift;
+    if (!(b & 0x80))
+      return v;
+  }
+  trace_corrupt(r);
+  return 0;
+}
+
+bool trace_next(struct trace_reader *r, struct trace_ref *ref)
+{
+  if (r->pos >= r->len && !read_block(r))
+    return false;
+
+  uint8_t head = r->raw[r->pos++];
+  ref->type = head & 0x3;
+  if (head & TRACE_PC_CHANGED)
+    r->st.last_pc += unzigzag(get_varint(r));
+  ref->pc = r->st.last_pc;
+
+  if (ref->type == TRACE_RETIRE) {
+    uint64_t len = (head & 0x4) ? 2 : 4;
+    if (r->pos + len > r->len)
+      trace_corrupt(r);
+    ref->insn = 0;
+    for (uint64_t i = 0; i < len; i++)
+      ref->insn |= (uint32_t)r->raw[r->pos++] << (8 * i);
+    ref->next_pc = ref->pc + len + unzigzag(get_varint(r));
+    r->st.last_pc = ref->next_pc;
+  } else {
+    uint8_t code = (head >> 2) & 0x7;
+    r->st.last_addr[ref->type] += unzigzag(get_varint(r));
+    ref->addr = r->st.last_addr[ref->type];
+    ref->width = code == TRACE_WIDTH_ESCAPE ? get_varint(r) : UINT64_C(1) << code;
+  }
+  return true;
+}
+
+void trace_close(struct trace_reader *r)
+{
+  fclose(r->f);
+  free(r->raw);
+  free(r->comp);
+  free(r);
+}
+
+uint64_t trace_replay(const char *file)
+{
+  struct trace_reader *r = trace_open(file);
+  struct trace_ref ref;
+  uint64_t records = 0;
+
+  while (trace_next(r, &ref)) {
+    records++;
+    if (ref.type == TRACE_RETIRE) {
+      stats_count(ref.pc, ref.next_pc, ref.insn);
+      if (timing_enabled)
+        timing_count(ref.pc, ref.next_pc, ref.insn);
+    } else if (sweep_enabled) {
+      /* La primera configuracion del barrido hace de L1 para las
+         estadisticas y el modelo de tiempos */
+      int hit = sweep_access((enum sweep_ref)ref.type, ref.addr, ref.width);
+      if (hit >= 0)
+        cache_stat(ref.type == TRACE_FETCH ? SIM_CACHE_L1_I + 1 : SIM_CACHE_L1_D + 1, hit);
+    }
+  }
+  trace_close(r);
+  return records;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Memory reference traces (--mem-trace <file>, --replay-trace <file>).
+
+   The recorder writes every fetch, load and store of the model (type,
+   physical address, width and PC) and every retired instruction (PC,
+   instruction bits and next PC) to <file>. Addresses and PCs are stored
+   as zigzag varint deltas against the previous one of the same kind, so a
+   record takes 2-4 bytes before compression, and blocks of 64 KiB are
+   compressed with zlib.
+
+   File: "CRMT", version (1), xlen, 2 reserved bytes, then blocks of
+   [raw length u32][compressed length u32][deflate data], little endian.
+
+   The reader API is used by --replay-trace to run the cache sweep
+   (riscv_sweep.h), the timing model (riscv_timing.h) and the instruction
+   counters on a saved trace without executing the program. The model's
+   caches are not replayed: the first configuration of the sweep stands in
+   for them, so --timing on a replay needs --cache-sweep. */
+
+enum trace_type {
+  TRACE_FETCH,
+  TRACE_LOAD,
+  TRACE_STORE,
+  TRACE_RETIRE
+};
+
+struct trace_ref {
+  enum trace_type type;
+  uint64_t pc;
+  uint64_t addr;    /* fetch, load, store */
+  uint64_t width;
+  uint32_t insn;    /* retire */
+  uint64_t next_pc;
+};
+
+struct trace_reader;
+
+extern bool trace_enabled;
+
+void trace_start(const char *file, int xlen);
+void trace_stop(void);
+void trace_mem(enum trace_type type, uint64_t pc, uint64_t addr, uint64_t width);
+void trace_retire(uint64_t pc, uint32_t insn, uint64_t next_pc);
+
+struct trace_reader *trace_open(const char *file);
+bool trace_next(struct trace_reader *r, struct trace_ref *ref);
+void trace_close(struct trace_reader *r);
+
+/* Feeds a whole trace to the harness models, returns the records read */
+uint64_t trace_replay(const char *file);
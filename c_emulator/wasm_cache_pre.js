@@ -0,0 +1,42 @@
+// Carga del .wasm para el IDE (se incluye con --pre-js en los binarios web).
+//
+// WebAssembly.compileStreaming compila mientras se descarga y el navegador
+// guarda el codigo compilado junto a la respuesta en su cache HTTP, asi que
+// las siguientes visitas no vuelven a compilar. Ademas el WebAssembly.Module
+// compilado se guarda por URL en la pagina: crear otra instancia (cambio de
+// arquitectura, reinicio) solo instancia. Para volver a ejecutar sin crear
+// otra instancia esta reset() en riscv_sim.c.
+//
+// No se usa IndexedDB: los navegadores ya no permiten guardar un
+// WebAssembly.Module en ella.
+if (typeof window == "object" && !Module["instantiateWasm"]) {
+  Module["instantiateWasm"] = function (imports, receiveInstance) {
+    var url = typeof findWasmBinary == "function" ? findWasmBinary() : wasmBinaryFile;
+    var modules = globalThis.creatorWasmModules = globalThis.creatorWasmModules || new Map();
+    var compiled = modules.get(url);
+
+    if (!compiled) {
+      compiled = WebAssembly.compileStreaming(fetch(url, { credentials: "same-origin" }))
+        .catch(function (e) {
+          // p.ej. el servidor no envia application/wasm
+          err("wasm streaming compile failed: " + e + ", falling back to ArrayBuffer");
+          return fetch(url, { credentials: "same-origin" })
+            .then(function (response) { return response.arrayBuffer(); })
+            .then(function (bytes) { return WebAssembly.compile(bytes); });
+        });
+      compiled.catch(function () { modules.delete(url); });
+      modules.set(url, compiled);
+    }
+
+    compiled
+      .then(function (module) {
+        return WebAssembly.instantiate(module, imports).then(function (instance) {
+          receiveInstance(instance, module);
+        });
+      })
+      .catch(function (e) {
+        abort("failed to instantiate " + url + ": " + e);
+      });
+    return {};
+  };
+}